@@ -0,0 +1,83 @@
+//! Timing and allocation counting shared by the benchmarks.
+//!
+//! Each benchmark is a plain binary (`harness = false`) that prints one line per case.
+
+#![allow(dead_code)]
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+/// How long each case is measured, after an untimed warm-up of the same length.
+pub const MEASURE_TIME: Duration = Duration::from_millis(500);
+/// Calls made between clock reads.
+const BATCH: u64 = 64;
+
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+/// Forwards to the system allocator and counts allocations from every thread.
+struct CountingAllocator;
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        // Safety: forwarded unchanged from the caller.
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        // Safety: forwarded unchanged from the caller.
+        unsafe { System.dealloc(ptr, layout) }
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Heap allocations made by the process so far.
+pub fn allocations() -> u64 {
+    ALLOCATIONS.load(Ordering::Relaxed)
+}
+
+/// Mean cost of one call of a measured function.
+#[derive(Clone, Copy, Debug)]
+pub struct Measurement {
+    pub ns: f64,
+    pub allocations: f64,
+}
+
+/// Calls `f` repeatedly for `MEASURE_TIME` after a warm-up and returns its mean cost.
+pub fn measure(mut f: impl FnMut()) -> Measurement {
+    run_for(MEASURE_TIME, &mut f);
+    let allocations = allocations();
+    let (calls, elapsed) = run_for(MEASURE_TIME, &mut f);
+    Measurement {
+        ns: elapsed.as_nanos() as f64 / calls as f64,
+        allocations: (self::allocations() - allocations) as f64 / calls as f64,
+    }
+}
+
+/// Calls `f` in batches until `duration` has passed, returning the calls made and the
+/// time they took.
+pub fn run_for(duration: Duration, f: &mut impl FnMut()) -> (u64, Duration) {
+    let start = Instant::now();
+    let mut calls = 0;
+    loop {
+        for _ in 0..BATCH {
+            f();
+        }
+        calls += BATCH;
+        let elapsed = start.elapsed();
+        if elapsed >= duration {
+            return (calls, elapsed);
+        }
+    }
+}
+
+/// Prints one result line.
+pub fn report(name: &str, measurement: Measurement) {
+    println!(
+        "{name:<44} {:>12.1} ns {:>10.2} allocations",
+        measurement.ns, measurement.allocations
+    );
+}
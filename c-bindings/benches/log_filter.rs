@@ -0,0 +1,64 @@
+//! Cost of the logger's filter check for an enabled and a disabled record, with 0, 5
+//! and 50 target directives, against the `RwLock` configuration and linear directive
+//! scan it replaced.
+//!
+//! Run with `cargo bench --features bench --bench log_filter`.
+
+mod common;
+
+use std::hint::black_box;
+
+use cspot::bench::logging::Filters;
+use log::{Level, Metadata};
+
+/// Directives a typical host sets, on top of the `info` default.
+const COMMON_DIRECTIVES: [&str; 5] = [
+    "librespot_core=debug",
+    "librespot_audio=warn",
+    "librespot_playback=info",
+    "librespot_connect=debug",
+    "libmdns=error",
+];
+
+fn spec(directives: usize) -> String {
+    let mut spec = vec!["info".to_string()];
+    spec.extend(
+        COMMON_DIRECTIVES
+            .iter()
+            .take(directives)
+            .map(|d| d.to_string()),
+    );
+    spec.extend(
+        (COMMON_DIRECTIVES.len()..directives).map(|index| format!("cspot_module_{index}=debug")),
+    );
+    spec.join(",")
+}
+
+fn main() {
+    let disabled = Metadata::builder()
+        .level(Level::Debug)
+        .target("librespot_playback::player")
+        .build();
+    let enabled = Metadata::builder()
+        .level(Level::Info)
+        .target("librespot_playback::player")
+        .build();
+
+    for directives in [0, 5, 50] {
+        let filters = Filters::parse(&spec(directives)).expect("benchmark specs are valid");
+        for (name, metadata) in [("disabled", &disabled), ("enabled", &enabled)] {
+            common::report(
+                &format!("{directives} directives, {name}, RwLock"),
+                common::measure(|| {
+                    black_box(filters.legacy_enabled(black_box(metadata)));
+                }),
+            );
+            common::report(
+                &format!("{directives} directives, {name}, lock-free"),
+                common::measure(|| {
+                    black_box(filters.enabled(black_box(metadata)));
+                }),
+            );
+        }
+    }
+}
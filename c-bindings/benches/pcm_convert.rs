@@ -0,0 +1,74 @@
+//! Sample conversion cost per frame for each output format, comparing cspot's
+//! `PcmConverter` with librespot's scalar `Converter`, with and without dither.
+//!
+//! Run with `cargo bench --features bench --bench pcm_convert`.
+
+mod common;
+
+use std::hint::black_box;
+
+use cspot::bench::convert::Converter;
+use librespot::playback::config::AudioFormat;
+use librespot::playback::convert::Converter as LibrespotConverter;
+use librespot::playback::dither::find_ditherer;
+
+const CHANNELS: usize = 2;
+/// Frames per packet, about what a decoder hands the sink at 44.1 kHz.
+const FRAMES: usize = 2048;
+
+const FORMATS: [(&str, AudioFormat); 6] = [
+    ("F64", AudioFormat::F64),
+    ("F32", AudioFormat::F32),
+    ("S32", AudioFormat::S32),
+    ("S24", AudioFormat::S24),
+    ("S24_3", AudioFormat::S24_3),
+    ("S16", AudioFormat::S16),
+];
+
+/// Converts the way librespot's own sinks do, allocating a new buffer per packet.
+fn librespot_convert(
+    converter: &mut LibrespotConverter,
+    format: AudioFormat,
+    samples: &[f64],
+) -> usize {
+    match format {
+        AudioFormat::F64 => size_of_val(black_box(samples)),
+        AudioFormat::F32 => size_of_val(black_box(converter.f64_to_f32(samples)).as_slice()),
+        AudioFormat::S32 => size_of_val(black_box(converter.f64_to_s32(samples)).as_slice()),
+        AudioFormat::S24 => size_of_val(black_box(converter.f64_to_s24(samples)).as_slice()),
+        AudioFormat::S24_3 => size_of_val(black_box(converter.f64_to_s24_3(samples)).as_slice()),
+        AudioFormat::S16 => size_of_val(black_box(converter.f64_to_s16(samples)).as_slice()),
+    }
+}
+
+fn main() {
+    let samples: Vec<f64> = (0..FRAMES * CHANNELS)
+        .map(|index| (index as f64 * 0.01).sin() * 0.8)
+        .collect();
+    let per_frame = |measurement: common::Measurement| common::Measurement {
+        ns: measurement.ns / FRAMES as f64,
+        allocations: measurement.allocations,
+    };
+
+    println!("per frame, {CHANNELS} channels; allocations per packet:");
+    for dither in [None, Some("tpdf")] {
+        let ditherer = || dither.and_then(|name| find_ditherer(Some(name.to_string())));
+        let suffix = dither.map_or(String::new(), |name| format!(", {name}"));
+        for (name, format) in FORMATS {
+            let mut converter = LibrespotConverter::new(ditherer());
+            common::report(
+                &format!("{name}{suffix}, librespot Converter"),
+                per_frame(common::measure(|| {
+                    librespot_convert(&mut converter, format, &samples);
+                })),
+            );
+            let mut converter = Converter::new(ditherer());
+            common::report(
+                &format!("{name}{suffix}, PcmConverter"),
+                per_frame(common::measure(|| {
+                    converter.convert(format, &samples);
+                })),
+            );
+        }
+    }
+}
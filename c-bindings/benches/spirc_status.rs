@@ -0,0 +1,33 @@
+//! Cost of one UI refresh of the spirc status: the 14 per-field getters, the same
+//! getters on the mutex-guarded status they used to read, and `cspot_spirc_get_status`.
+//!
+//! Run with `cargo bench --features bench --bench spirc_status`.
+
+mod common;
+
+use std::mem::MaybeUninit;
+
+use cspot::bench::spirc_status::{
+    Status, cspot_spirc_status_init, cspot_spirc_status_release, cspot_spirc_status_t,
+};
+
+fn main() {
+    let status = Status::default();
+    println!("per refresh:");
+
+    common::report(
+        "per-field getters, Mutex<SpircRuntimeStatus>",
+        common::measure(|| status.legacy_get_fields()),
+    );
+    common::report("per-field getters", common::measure(|| status.get_fields()));
+
+    let mut snapshot = MaybeUninit::<cspot_spirc_status_t>::uninit();
+    cspot_spirc_status_init(snapshot.as_mut_ptr());
+    // Safety: cspot_spirc_status_init initialized the snapshot.
+    let mut snapshot = unsafe { snapshot.assume_init() };
+    common::report(
+        "cspot_spirc_get_status",
+        common::measure(|| status.get_status(&mut snapshot)),
+    );
+    cspot_spirc_status_release(&mut snapshot);
+}
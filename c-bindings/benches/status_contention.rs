@@ -0,0 +1,90 @@
+//! Reader and writer latency of spirc status publication under contention.
+//!
+//! One thread publishes position updates back to back, as the status task would
+//! during a burst of player events, while 1 to 8 threads refresh the status. Lock-free
+//! publication should keep both sides flat as readers are added; the mutex-guarded
+//! status it replaced slows both down.
+//!
+//! Run with `cargo bench --features bench --bench status_contention`.
+
+mod common;
+
+use std::mem::MaybeUninit;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::thread;
+use std::time::Instant;
+
+use cspot::bench::spirc_status::{
+    Status, cspot_spirc_status_init, cspot_spirc_status_release, cspot_spirc_status_t,
+};
+
+const READER_COUNTS: [usize; 4] = [1, 2, 4, 8];
+
+/// Runs one writer against `readers` readers and returns the mean ns per refresh and
+/// per update.
+fn contend(status: &Status, readers: usize, legacy: bool) -> (f64, f64) {
+    let stop = AtomicBool::new(false);
+    thread::scope(|scope| {
+        let writer = scope.spawn(|| {
+            let mut writer = status.writer();
+            let mut updates = 0u64;
+            let start = Instant::now();
+            while !stop.load(Ordering::Relaxed) {
+                let position_ms = (updates % 200) as u32 * 1000;
+                if legacy {
+                    status.legacy_publish_position(position_ms);
+                } else {
+                    status.publish_position(&mut writer, position_ms);
+                }
+                updates += 1;
+            }
+            start.elapsed().as_nanos() as f64 / updates.max(1) as f64
+        });
+
+        let readers: Vec<_> = (0..readers)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut snapshot = MaybeUninit::<cspot_spirc_status_t>::uninit();
+                    cspot_spirc_status_init(snapshot.as_mut_ptr());
+                    // Safety: cspot_spirc_status_init initialized the snapshot.
+                    let mut snapshot = unsafe { snapshot.assume_init() };
+                    let (refreshes, elapsed) = common::run_for(common::MEASURE_TIME, &mut || {
+                        if legacy {
+                            status.legacy_get_fields();
+                        } else {
+                            status.get_status(&mut snapshot);
+                        }
+                    });
+                    cspot_spirc_status_release(&mut snapshot);
+                    elapsed.as_nanos() as f64 / refreshes as f64
+                })
+            })
+            .collect();
+        let reader_count = readers.len() as f64;
+        let reader_ns = readers
+            .into_iter()
+            .map(|reader| reader.join().unwrap_or(f64::NAN))
+            .sum::<f64>()
+            / reader_count;
+        stop.store(true, Ordering::Relaxed);
+        let writer_ns = writer.join().unwrap_or(f64::NAN);
+        (reader_ns, writer_ns)
+    })
+}
+
+fn main() {
+    let status = Status::default();
+    println!(
+        "{:<36} {:>16} {:>16}",
+        "readers + 1 writer", "ns per refresh", "ns per update"
+    );
+    for (name, legacy) in [("Mutex<SpircRuntimeStatus>", true), ("lock-free", false)] {
+        for readers in READER_COUNTS {
+            let (reader_ns, writer_ns) = contend(&status, readers, legacy);
+            println!(
+                "{:<36} {reader_ns:>16.1} {writer_ns:>16.1}",
+                format!("{name}, {readers} readers")
+            );
+        }
+    }
+}
@@ -0,0 +1,556 @@
+//! Cover art downloads backed by a shared memory and disk cache.
+//!
+//! Images are cached as the encoded bytes Spotify serves, keyed by image id, so the
+//! same cover is stored once whichever track or spirc asked for it. Concurrent
+//! requests for one image share a single download.
+
+use std::collections::{BTreeMap, HashMap};
+use std::fs;
+use std::os::raw::{c_char, c_void};
+use std::path::PathBuf;
+use std::ptr;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+use futures_util::FutureExt;
+use futures_util::future::{BoxFuture, Shared};
+use librespot::core::{FileId, session::Session};
+use once_cell::sync::Lazy;
+
+use crate::async_op::{cspot_async_callback_t, cspot_async_op_t, spawn_async_op, take_async_value};
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::ffi::{read_cstr, read_optional_cstr};
+use crate::metadata::{Cover, lookup};
+use crate::metrics::METRICS;
+use crate::session::{cspot_session_t, session_from_handle};
+
+/// Bytes of images kept in memory unless configured otherwise.
+const DEFAULT_MEMORY_BYTES: u64 = 8 * 1024 * 1024;
+
+/// Cover art size classes, smallest first.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, Ord, PartialEq, PartialOrd)]
+#[repr(C)]
+pub enum cspot_artwork_size_t {
+    /// About 64 pixels wide.
+    CSPOT_ARTWORK_SIZE_SMALL = 0,
+    /// About 300 pixels wide.
+    CSPOT_ARTWORK_SIZE_DEFAULT = 1,
+    /// About 640 pixels wide.
+    CSPOT_ARTWORK_SIZE_LARGE = 2,
+    /// The largest size Spotify offers.
+    CSPOT_ARTWORK_SIZE_XLARGE = 3,
+}
+
+/// Opaque handle for downloaded cover art.
+#[allow(non_camel_case_types)]
+pub struct cspot_artwork_t;
+
+/// Artwork cache configuration passed to `cspot_artwork_cache_configure`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_artwork_cache_config_t {
+    /// Directory for cached images; null keeps images in memory only.
+    pub dir: *const c_char,
+    /// Upper bound on images kept in memory, in bytes; 0 disables the memory cache.
+    pub max_memory_bytes: u64,
+    /// Upper bound on the size of `dir` in bytes; 0 means unlimited. When the limit is
+    /// exceeded, the least recently written images are removed.
+    pub max_disk_bytes: u64,
+}
+
+impl Default for cspot_artwork_cache_config_t {
+    fn default() -> Self {
+        Self {
+            dir: ptr::null(),
+            max_memory_bytes: DEFAULT_MEMORY_BYTES,
+            max_disk_bytes: 0,
+        }
+    }
+}
+
+/// Artwork cache counters reported by `cspot_artwork_cache_stats`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_artwork_cache_stats_t {
+    /// Requests answered from memory.
+    pub memory_hits: u64,
+    /// Requests answered from the disk cache.
+    pub disk_hits: u64,
+    /// Images downloaded.
+    pub downloads: u64,
+    /// Requests that joined a download already in progress.
+    pub shared_downloads: u64,
+    /// Bytes of images currently in memory.
+    pub memory_bytes: u64,
+    /// Bytes of images currently in the disk cache.
+    pub disk_bytes: u64,
+}
+
+struct Artwork {
+    data: Arc<[u8]>,
+    size: cspot_artwork_size_t,
+    width: u32,
+    height: u32,
+}
+
+struct MemoryEntry {
+    data: Arc<[u8]>,
+    last_used: u64,
+}
+
+/// Byte-bounded LRU of encoded images keyed by image id.
+struct MemoryCache {
+    entries: HashMap<String, MemoryEntry>,
+    /// Entries ordered by last use, oldest first.
+    recency: BTreeMap<u64, String>,
+    clock: u64,
+    bytes: u64,
+    max_bytes: u64,
+}
+
+impl MemoryCache {
+    fn get(&mut self, id: &str) -> Option<Arc<[u8]>> {
+        self.clock += 1;
+        let entry = self.entries.get_mut(id)?;
+        self.recency.remove(&entry.last_used);
+        self.recency.insert(self.clock, id.to_string());
+        entry.last_used = self.clock;
+        Some(Arc::clone(&entry.data))
+    }
+
+    fn insert(&mut self, id: &str, data: Arc<[u8]>) {
+        if data.len() as u64 > self.max_bytes {
+            return;
+        }
+        self.clock += 1;
+        self.bytes += data.len() as u64;
+        let entry = MemoryEntry {
+            data,
+            last_used: self.clock,
+        };
+        if let Some(previous) = self.entries.insert(id.to_string(), entry) {
+            self.recency.remove(&previous.last_used);
+            self.bytes -= previous.data.len() as u64;
+        }
+        self.recency.insert(self.clock, id.to_string());
+        self.trim();
+    }
+
+    fn trim(&mut self) {
+        while self.bytes > self.max_bytes {
+            let Some((_, id)) = self.recency.pop_first() else {
+                break;
+            };
+            if let Some(entry) = self.entries.remove(&id) {
+                self.bytes -= entry.data.len() as u64;
+            }
+        }
+    }
+}
+
+/// Image files in the cache directory, one file per image id.
+struct DiskCache {
+    dir: PathBuf,
+    max_bytes: Option<u64>,
+    bytes: u64,
+}
+
+impl DiskCache {
+    fn open(dir: PathBuf, max_bytes: Option<u64>) -> Result<Self, String> {
+        fs::create_dir_all(&dir)
+            .map_err(|err| format!("failed to create artwork cache directory: {err}"))?;
+        let mut cache = Self {
+            dir,
+            max_bytes,
+            bytes: 0,
+        };
+        cache.bytes = cache.files().iter().map(|(_, len, _)| len).sum();
+        cache.trim();
+        Ok(cache)
+    }
+
+    fn path(&self, id: &str) -> PathBuf {
+        self.dir.join(id)
+    }
+
+    fn files(&self) -> Vec<(PathBuf, u64, std::time::SystemTime)> {
+        let Ok(entries) = fs::read_dir(&self.dir) else {
+            return Vec::new();
+        };
+        entries
+            .flatten()
+            .filter_map(|entry| {
+                let meta = entry.metadata().ok().filter(|meta| meta.is_file())?;
+                let modified = meta.modified().unwrap_or(std::time::UNIX_EPOCH);
+                Some((entry.path(), meta.len(), modified))
+            })
+            .collect()
+    }
+
+    fn write(&mut self, id: &str, data: &[u8]) {
+        let path = self.path(id);
+        let previous = fs::metadata(&path).map(|meta| meta.len()).unwrap_or(0);
+        // Written beside the final name and renamed into place, so a concurrent reader
+        // or a crash never leaves a truncated image under the id.
+        let partial = self.path(&format!("{id}.tmp"));
+        if let Err(err) = fs::write(&partial, data).and_then(|_| fs::rename(&partial, &path)) {
+            log::warn!("failed to write artwork to cache: {err}");
+            let _ = fs::remove_file(&partial);
+            return;
+        }
+        self.bytes = self.bytes - previous.min(self.bytes) + data.len() as u64;
+        self.trim();
+    }
+
+    /// Removes the oldest images until the directory is within its limit.
+    fn trim(&mut self) {
+        let Some(max_bytes) = self.max_bytes else {
+            return;
+        };
+        if self.bytes <= max_bytes {
+            return;
+        }
+        let mut files = self.files();
+        files.sort_by_key(|(_, _, modified)| *modified);
+        self.bytes = files.iter().map(|(_, len, _)| len).sum();
+        for (path, len, _) in files {
+            if self.bytes <= max_bytes {
+                break;
+            }
+            if fs::remove_file(&path).is_ok() {
+                self.bytes -= len;
+            }
+        }
+    }
+}
+
+type Download = Shared<BoxFuture<'static, Result<Arc<[u8]>, String>>>;
+
+struct ArtworkCache {
+    memory: Mutex<MemoryCache>,
+    disk: Mutex<Option<DiskCache>>,
+    in_flight: Mutex<HashMap<String, Download>>,
+    memory_hits: AtomicU64,
+    disk_hits: AtomicU64,
+    downloads: AtomicU64,
+    shared_downloads: AtomicU64,
+}
+
+static ARTWORK_CACHE: Lazy<ArtworkCache> = Lazy::new(|| ArtworkCache {
+    memory: Mutex::new(MemoryCache {
+        entries: HashMap::new(),
+        recency: BTreeMap::new(),
+        clock: 0,
+        bytes: 0,
+        max_bytes: DEFAULT_MEMORY_BYTES,
+    }),
+    disk: Mutex::new(None),
+    in_flight: Mutex::new(HashMap::new()),
+    memory_hits: AtomicU64::new(0),
+    disk_hits: AtomicU64::new(0),
+    downloads: AtomicU64::new(0),
+    shared_downloads: AtomicU64::new(0),
+});
+
+fn lock<T>(mutex: &Mutex<T>) -> std::sync::MutexGuard<'_, T> {
+    mutex
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Extracts the image id from a cover URL such as `https://i.scdn.co/image/<id>`.
+fn image_id(url: &str) -> Result<(String, FileId), String> {
+    let id = url
+        .rsplit('/')
+        .next()
+        .unwrap_or_default()
+        .to_ascii_lowercase();
+    let raw = data_encoding::HEXLOWER
+        .decode(id.as_bytes())
+        .ok()
+        .filter(|raw| raw.len() == 20)
+        .ok_or_else(|| format!("unsupported artwork URL: {url}"))?;
+    Ok((id, FileId::from(raw.as_slice())))
+}
+
+/// Picks the cover closest to `size`, preferring larger ones on a tie.
+fn select_cover(covers: &[Cover], size: cspot_artwork_size_t) -> Option<&Cover> {
+    covers.iter().min_by_key(|cover| {
+        let distance = (cover.size as i32 - size as i32).abs();
+        (distance, cover.size < size)
+    })
+}
+
+impl ArtworkCache {
+    /// Returns the encoded image, from memory, disk, or a shared download.
+    async fn load(&'static self, session: Session, url: &str) -> Result<Arc<[u8]>, String> {
+        let (id, file_id) = image_id(url)?;
+        if let Some(data) = lock(&self.memory).get(&id) {
+            self.memory_hits.fetch_add(1, Ordering::Relaxed);
+            return Ok(data);
+        }
+
+        let download = {
+            let mut in_flight = lock(&self.in_flight);
+            match in_flight.get(&id) {
+                Some(download) => {
+                    self.shared_downloads.fetch_add(1, Ordering::Relaxed);
+                    download.clone()
+                }
+                None => {
+                    let download = self.fetch(session, id.clone(), file_id).boxed().shared();
+                    in_flight.insert(id, download.clone());
+                    download
+                }
+            }
+        };
+        download.await
+    }
+
+    async fn fetch(
+        &'static self,
+        session: Session,
+        id: String,
+        file_id: FileId,
+    ) -> Result<Arc<[u8]>, String> {
+        let result = self.fetch_uncached(session, &id, file_id).await;
+        if let Ok(data) = &result {
+            lock(&self.memory).insert(&id, Arc::clone(data));
+        }
+        lock(&self.in_flight).remove(&id);
+        result
+    }
+
+    async fn fetch_uncached(
+        &'static self,
+        session: Session,
+        id: &str,
+        file_id: FileId,
+    ) -> Result<Arc<[u8]>, String> {
+        let path = lock(&self.disk).as_ref().map(|disk| disk.path(id));
+        if let Some(path) = path {
+            let cached = tokio::task::spawn_blocking(move || fs::read(path).ok())
+                .await
+                .ok()
+                .flatten();
+            if let Some(data) = cached {
+                self.disk_hits.fetch_add(1, Ordering::Relaxed);
+                return Ok(data.into());
+            }
+        }
+
+        let data: Arc<[u8]> = session
+            .spclient()
+            .get_image(&file_id)
+            .await
+            .map_err(|err| format!("failed to download artwork: {err}"))?
+            .to_vec()
+            .into();
+        self.downloads.fetch_add(1, Ordering::Relaxed);
+        METRICS.artwork_bytes_downloaded.add(data.len() as u64);
+
+        let id = id.to_string();
+        let written = Arc::clone(&data);
+        let _ = tokio::task::spawn_blocking(move || {
+            if let Some(disk) = lock(&ARTWORK_CACHE.disk).as_mut() {
+                disk.write(&id, &written);
+            }
+        })
+        .await;
+        Ok(data)
+    }
+}
+
+async fn fetch_artwork(
+    session: Session,
+    uri: String,
+    size: cspot_artwork_size_t,
+) -> Result<Artwork, String> {
+    let record = lookup(session.clone(), uri).await?;
+    let cover =
+        select_cover(&record.covers, size).ok_or_else(|| "track has no artwork".to_string())?;
+    let url = cover.url.to_string_lossy().into_owned();
+    let data = ARTWORK_CACHE.load(session, &url).await?;
+    Ok(Artwork {
+        data,
+        size: cover.size,
+        width: cover.width,
+        height: cover.height,
+    })
+}
+
+fn artwork_from_handle<'a>(artwork: *const cspot_artwork_t) -> Option<&'a Artwork> {
+    if artwork.is_null() {
+        return None;
+    }
+    // Safety: artwork must be a valid handle allocated by cspot and outlives the call.
+    Some(unsafe { &*(artwork as *const Artwork) })
+}
+
+/// Initializes an artwork cache configuration with the defaults: 8 MiB in memory and
+/// no disk cache.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_cache_config_init(config: *mut cspot_artwork_cache_config_t) {
+    if config.is_null() {
+        return;
+    }
+    // Safety: caller provided a writable config pointer.
+    unsafe {
+        *config = cspot_artwork_cache_config_t::default();
+    }
+}
+
+/// Configures the process-wide artwork cache.
+///
+/// Images already in memory are kept up to the new limit. The directory is created
+/// if needed. Returns false and writes an error if it cannot be created.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_cache_configure(
+    config: *const cspot_artwork_cache_config_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    if config.is_null() {
+        write_error(out_error, "artwork cache config was null");
+        return false;
+    }
+    // Safety: config must point to a valid cspot_artwork_cache_config_t.
+    let config = unsafe { &*config };
+    let max_disk_bytes = (config.max_disk_bytes > 0).then_some(config.max_disk_bytes);
+    let disk = match read_optional_cstr(config.dir) {
+        Some(dir) => match DiskCache::open(PathBuf::from(dir), max_disk_bytes) {
+            Ok(disk) => Some(disk),
+            Err(err) => {
+                write_error(out_error, err);
+                return false;
+            }
+        },
+        None => None,
+    };
+    *lock(&ARTWORK_CACHE.disk) = disk;
+    let mut memory = lock(&ARTWORK_CACHE.memory);
+    memory.max_bytes = config.max_memory_bytes;
+    memory.trim();
+    true
+}
+
+/// Reads the counters of the process-wide artwork cache.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_cache_stats(out_stats: *mut cspot_artwork_cache_stats_t) -> bool {
+    if out_stats.is_null() {
+        return false;
+    }
+    let cache = &*ARTWORK_CACHE;
+    let stats = cspot_artwork_cache_stats_t {
+        memory_hits: cache.memory_hits.load(Ordering::Relaxed),
+        disk_hits: cache.disk_hits.load(Ordering::Relaxed),
+        downloads: cache.downloads.load(Ordering::Relaxed),
+        shared_downloads: cache.shared_downloads.load(Ordering::Relaxed),
+        memory_bytes: lock(&cache.memory).bytes,
+        disk_bytes: lock(&cache.disk).as_ref().map_or(0, |disk| disk.bytes),
+    };
+    // Safety: out_stats is non-null and points to writable memory.
+    unsafe {
+        *out_stats = stats;
+    }
+    true
+}
+
+/// Fetches the cover art of a track or episode URI without blocking.
+///
+/// Uses the cover closest to `size`. Images come from the artwork cache when possible,
+/// and concurrent requests for the same image share one download. Claim the image
+/// with `cspot_async_op_take_artwork`. The operation handle must be released with
+/// `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_fetch(
+    session: *const cspot_session_t,
+    uri: *const c_char,
+    size: cspot_artwork_size_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let Some(uri) = read_cstr(uri, "uri", out_error) else {
+        return ptr::null_mut();
+    };
+    let Some(session) = session_from_handle(session) else {
+        write_error(out_error, "session handle was null");
+        return ptr::null_mut();
+    };
+    spawn_async_op(fetch_artwork(session, uri, size), callback, user_data)
+}
+
+/// Claims the image produced by `cspot_artwork_fetch`.
+///
+/// Returns null and writes an error if the operation has not completed successfully.
+/// The returned handle must be released with `cspot_artwork_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_artwork(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_artwork_t {
+    match take_async_value::<Artwork>(op, out_error) {
+        Some(artwork) => Box::into_raw(Box::new(artwork)) as *mut cspot_artwork_t,
+        None => ptr::null_mut(),
+    }
+}
+
+/// Returns the encoded image bytes (usually JPEG) and writes their length to `out_len`.
+///
+/// The bytes are shared with the artwork cache and remain valid until the handle is
+/// freed.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_data(
+    artwork: *const cspot_artwork_t,
+    out_len: *mut usize,
+) -> *const u8 {
+    let (data, len) = match artwork_from_handle(artwork) {
+        Some(artwork) => (artwork.data.as_ptr(), artwork.data.len()),
+        None => (ptr::null(), 0),
+    };
+    if !out_len.is_null() {
+        // Safety: out_len is non-null and points to writable memory.
+        unsafe {
+            *out_len = len;
+        }
+    }
+    data
+}
+
+/// Returns the size class of the fetched image.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_size(artwork: *const cspot_artwork_t) -> cspot_artwork_size_t {
+    artwork_from_handle(artwork).map_or(
+        cspot_artwork_size_t::CSPOT_ARTWORK_SIZE_DEFAULT,
+        |artwork| artwork.size,
+    )
+}
+
+/// Returns the image width in pixels, or 0 if unknown.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_width(artwork: *const cspot_artwork_t) -> u32 {
+    artwork_from_handle(artwork).map_or(0, |artwork| artwork.width)
+}
+
+/// Returns the image height in pixels, or 0 if unknown.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_height(artwork: *const cspot_artwork_t) -> u32 {
+    artwork_from_handle(artwork).map_or(0, |artwork| artwork.height)
+}
+
+/// Frees an artwork handle.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_artwork_free(artwork: *mut cspot_artwork_t) {
+    if artwork.is_null() {
+        return;
+    }
+    // Safety: artwork must be a valid handle allocated by cspot.
+    unsafe {
+        drop(Box::from_raw(artwork as *mut Artwork));
+    }
+}
@@ -0,0 +1,265 @@
+//! Completion handles for non-blocking cspot operations.
+
+use std::any::Any;
+use std::future::Future;
+use std::os::raw::{c_int, c_void};
+use std::panic::AssertUnwindSafe;
+use std::sync::{Arc, Mutex};
+
+use futures_util::FutureExt;
+use tokio::task::AbortHandle;
+
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::notify::Notifier;
+use crate::runtime::{runtime, wake_host};
+use crate::runtime_stats::{TaskKind, monitored};
+
+/// Opaque handle for an operation running on the cspot runtime.
+#[allow(non_camel_case_types)]
+pub struct cspot_async_op_t;
+
+/// State of an asynchronous operation.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_async_status_t {
+    CSPOT_ASYNC_PENDING = 0,
+    CSPOT_ASYNC_COMPLETED = 1,
+    CSPOT_ASYNC_FAILED = 2,
+    CSPOT_ASYNC_CANCELLED = 3,
+}
+
+/// Callback invoked once when an asynchronous operation completes or fails.
+///
+/// The callback runs on a cspot runtime thread and should return quickly. It may take
+/// the operation's result, but must not free the operation handle. It is not invoked
+/// for cancelled operations.
+#[allow(non_camel_case_types)]
+pub type cspot_async_callback_t =
+    Option<extern "C" fn(op: *mut cspot_async_op_t, user_data: *mut c_void)>;
+
+type AsyncValue = Box<dyn Any + Send>;
+
+struct AsyncState {
+    status: cspot_async_status_t,
+    value: Option<AsyncValue>,
+    error: Option<String>,
+    abort: Option<AbortHandle>,
+}
+
+struct AsyncOp {
+    state: Mutex<AsyncState>,
+    ready: Notifier,
+    callback: cspot_async_callback_t,
+    user_data: usize,
+}
+
+impl AsyncOp {
+    fn complete(self: &Arc<Self>, result: Result<AsyncValue, String>) {
+        {
+            let mut state = lock_state(&self.state);
+            if state.status != cspot_async_status_t::CSPOT_ASYNC_PENDING {
+                return;
+            }
+            match result {
+                Ok(value) => {
+                    state.status = cspot_async_status_t::CSPOT_ASYNC_COMPLETED;
+                    state.value = Some(value);
+                }
+                Err(message) => {
+                    state.status = cspot_async_status_t::CSPOT_ASYNC_FAILED;
+                    state.error = Some(message);
+                }
+            }
+            state.abort = None;
+        }
+        self.ready.notify();
+        wake_host();
+        if let Some(callback) = self.callback {
+            callback(
+                Arc::as_ptr(self) as *mut cspot_async_op_t,
+                self.user_data as *mut c_void,
+            );
+        }
+    }
+
+    fn cancel(&self) -> bool {
+        let abort = {
+            let mut state = lock_state(&self.state);
+            if state.status != cspot_async_status_t::CSPOT_ASYNC_PENDING {
+                return false;
+            }
+            state.status = cspot_async_status_t::CSPOT_ASYNC_CANCELLED;
+            state.abort.take()
+        };
+        if let Some(abort) = abort {
+            abort.abort();
+        }
+        self.ready.notify();
+        true
+    }
+}
+
+fn lock_state(state: &Mutex<AsyncState>) -> std::sync::MutexGuard<'_, AsyncState> {
+    state
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+fn op_from_handle<'a>(op: *const cspot_async_op_t) -> Option<&'a AsyncOp> {
+    if op.is_null() {
+        return None;
+    }
+    // Safety: op must be a valid handle allocated by cspot and outlives the call.
+    Some(unsafe { &*(op as *const AsyncOp) })
+}
+
+/// Runs `future` on the cspot runtime and returns a handle tracking its completion.
+///
+/// The value produced by the future is kept until one of the typed take functions
+/// claims it, or is dropped together with the handle.
+pub(crate) fn spawn_async_op<F, T>(
+    future: F,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+) -> *mut cspot_async_op_t
+where
+    F: Future<Output = Result<T, String>> + Send + 'static,
+    T: Any + Send,
+{
+    let op = Arc::new(AsyncOp {
+        state: Mutex::new(AsyncState {
+            status: cspot_async_status_t::CSPOT_ASYNC_PENDING,
+            value: None,
+            error: None,
+            abort: None,
+        }),
+        ready: Notifier::new(),
+        callback,
+        user_data: user_data as usize,
+    });
+
+    let task_op = Arc::clone(&op);
+    let task = runtime().spawn(monitored(TaskKind::AsyncOp, async move {
+        let result = match AssertUnwindSafe(future).catch_unwind().await {
+            Ok(Ok(value)) => Ok(Box::new(value) as AsyncValue),
+            Ok(Err(message)) => Err(message),
+            Err(_) => Err("panic in asynchronous operation".to_string()),
+        };
+        task_op.complete(result);
+    }));
+    {
+        let mut state = lock_state(&op.state);
+        if state.status == cspot_async_status_t::CSPOT_ASYNC_PENDING {
+            state.abort = Some(task.abort_handle());
+        }
+    }
+    Arc::into_raw(op) as *mut cspot_async_op_t
+}
+
+/// Claims the value of a completed operation.
+///
+/// Writes an error and returns `None` if the operation is not completed, failed, was
+/// cancelled, was already taken, or produced a value of a different type.
+pub(crate) fn take_async_value<T: Any>(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> Option<T> {
+    clear_error(out_error);
+    let Some(op) = op_from_handle(op) else {
+        write_error(out_error, "async operation handle was null");
+        return None;
+    };
+    let mut state = lock_state(&op.state);
+    match state.status {
+        cspot_async_status_t::CSPOT_ASYNC_PENDING => {
+            write_error(out_error, "async operation has not completed");
+            return None;
+        }
+        cspot_async_status_t::CSPOT_ASYNC_CANCELLED => {
+            write_error(out_error, "async operation was cancelled");
+            return None;
+        }
+        cspot_async_status_t::CSPOT_ASYNC_FAILED => {
+            let message = state.error.as_deref().unwrap_or("async operation failed");
+            write_error(out_error, message);
+            return None;
+        }
+        cspot_async_status_t::CSPOT_ASYNC_COMPLETED => {}
+    }
+    let Some(value) = state.value.take() else {
+        write_error(out_error, "async operation result was already taken");
+        return None;
+    };
+    match value.downcast::<T>() {
+        Ok(value) => Some(*value),
+        Err(value) => {
+            state.value = Some(value);
+            write_error(
+                out_error,
+                "async operation produced a different result type",
+            );
+            None
+        }
+    }
+}
+
+/// Returns the current state of an asynchronous operation.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_status(op: *const cspot_async_op_t) -> cspot_async_status_t {
+    match op_from_handle(op) {
+        Some(op) => lock_state(&op.state).status,
+        None => cspot_async_status_t::CSPOT_ASYNC_FAILED,
+    }
+}
+
+/// Returns a descriptor that becomes readable once the operation leaves the pending state.
+///
+/// The descriptor is owned by the operation handle and must not be read or closed by
+/// the caller. Returns -1 if unavailable, including on platforms without file
+/// descriptors.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_fd(op: *const cspot_async_op_t) -> c_int {
+    match op_from_handle(op) {
+        Some(op) => op.ready.fd(),
+        None => -1,
+    }
+}
+
+/// Reports whether an operation without a result value completed successfully.
+///
+/// Returns true when the operation completed. Otherwise returns false and writes an
+/// error describing why; pending operations are reported as errors as well.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_finish(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    take_async_value::<()>(op, out_error).is_some()
+}
+
+/// Cancels a pending operation.
+///
+/// Returns true if the operation was still pending. Work that has not completed is
+/// dropped, and the completion callback is not invoked.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_cancel(op: *const cspot_async_op_t) -> bool {
+    match op_from_handle(op) {
+        Some(op) => op.cancel(),
+        None => false,
+    }
+}
+
+/// Frees an asynchronous operation handle, cancelling it if it is still pending.
+///
+/// Results that were not taken are released. Must not be called from inside the
+/// operation's completion callback.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_free(op: *mut cspot_async_op_t) {
+    if op.is_null() {
+        return;
+    }
+    // Safety: op must be a valid handle allocated by cspot.
+    let op = unsafe { Arc::from_raw(op as *const AsyncOp) };
+    op.cancel();
+}
@@ -0,0 +1,21 @@
+//! Internals exposed to the benchmarks in `benches/`.
+//!
+//! Only built with the `bench` feature. Nothing here is part of the C API.
+
+/// Spirc status reads and publication.
+pub mod spirc_status {
+    pub use crate::connect::bench::{Status, StatusWriter};
+    pub use crate::connect::{
+        cspot_spirc_status_init, cspot_spirc_status_release, cspot_spirc_status_t,
+    };
+}
+
+/// PCM conversion in cspot's sinks.
+pub mod convert {
+    pub use crate::convert::bench::Converter;
+}
+
+/// Log filtering in cspot's logger.
+pub mod logging {
+    pub use crate::logging::bench::Filters;
+}
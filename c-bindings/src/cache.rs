@@ -0,0 +1,311 @@
+//! Persistent audio cache configuration and statistics.
+//!
+//! librespot's `Cache` has no hooks for reads or evictions, so cspot derives its
+//! statistics from what it can observe: each track the player loads is checked
+//! against the cache, and the audio directory is rescanned when statistics are read
+//! to see which downloads landed and which files the size limit removed.
+
+use std::collections::HashMap;
+use std::fs;
+use std::os::raw::c_char;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+use librespot::core::{cache::Cache, session::Session};
+use librespot::metadata::audio::AudioItem;
+use librespot::playback::player::{Player, PlayerEvent};
+
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::ffi::read_optional_cstr;
+use crate::metrics::METRICS;
+use crate::runtime::runtime;
+use crate::runtime_stats::{TaskKind, monitored};
+use crate::session::{cache_stats_from_handle, cspot_session_t};
+
+/// Downloads awaiting their first appearance on disk; older ones are forgotten.
+const MAX_PENDING_DOWNLOADS: usize = 64;
+
+/// Cache configuration passed to `cspot_session_create_with_cache`.
+///
+/// Null directories disable that part of the cache.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_cache_config_t {
+    /// Directory for downloaded audio files.
+    pub audio_dir: *const c_char,
+    /// Directory for stored credentials and the last volume.
+    pub system_dir: *const c_char,
+    /// Upper bound on the size of `audio_dir` in bytes; 0 means unlimited. When the
+    /// limit is exceeded, the least recently used files are removed.
+    pub max_size_bytes: u64,
+}
+
+impl Default for cspot_cache_config_t {
+    fn default() -> Self {
+        Self {
+            audio_dir: std::ptr::null(),
+            system_dir: std::ptr::null(),
+            max_size_bytes: 0,
+        }
+    }
+}
+
+/// Audio cache counters reported by `cspot_cache_stats`.
+///
+/// Hits and misses are counted per track the player loads. Network bytes are counted
+/// once a missed file has been written to the cache, and evictions once a cached file
+/// is no longer on disk.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_cache_stats_t {
+    /// Tracks whose audio was already cached.
+    pub hits: u64,
+    /// Tracks whose audio had to be downloaded.
+    pub misses: u64,
+    /// Bytes of audio played from the cache.
+    pub bytes_from_disk: u64,
+    /// Bytes of audio downloaded and stored in the cache.
+    pub bytes_from_network: u64,
+    /// Cached files removed since the session was created.
+    pub evictions: u64,
+    /// Files currently in the audio cache.
+    pub cached_files: u64,
+    /// Bytes currently in the audio cache.
+    pub cached_bytes: u64,
+}
+
+/// Cache owned by a session, resolved from a `cspot_cache_config_t`.
+pub(crate) struct CacheSettings {
+    audio_dir: Option<PathBuf>,
+    system_dir: Option<PathBuf>,
+    max_size_bytes: Option<u64>,
+}
+
+impl CacheSettings {
+    pub(crate) fn from_config(config: &cspot_cache_config_t) -> Self {
+        Self {
+            audio_dir: read_optional_cstr(config.audio_dir).map(PathBuf::from),
+            system_dir: read_optional_cstr(config.system_dir).map(PathBuf::from),
+            max_size_bytes: (config.max_size_bytes > 0).then_some(config.max_size_bytes),
+        }
+    }
+
+    /// Opens the cache, creating its directories if needed.
+    pub(crate) fn open(&self) -> Result<(Cache, Option<Arc<CacheStats>>), String> {
+        let cache = Cache::new(
+            self.system_dir.as_deref(),
+            self.system_dir.as_deref(),
+            self.audio_dir.as_deref(),
+            self.max_size_bytes,
+        )
+        .map_err(|err| format!("failed to open cache: {err}"))?;
+        let stats = self
+            .audio_dir
+            .clone()
+            .map(|dir| Arc::new(CacheStats::new(dir)));
+        Ok((cache, stats))
+    }
+}
+
+struct DiskState {
+    /// Files seen by the last scan, with their sizes.
+    files: HashMap<PathBuf, u64>,
+    /// Files of missed tracks that have not been seen on disk yet.
+    pending: Vec<PathBuf>,
+}
+
+/// Statistics for a session's audio cache.
+pub(crate) struct CacheStats {
+    audio_dir: PathBuf,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    bytes_from_disk: AtomicU64,
+    bytes_from_network: AtomicU64,
+    evictions: AtomicU64,
+    disk: Mutex<DiskState>,
+}
+
+impl CacheStats {
+    fn new(audio_dir: PathBuf) -> Self {
+        let files = scan_audio_dir(&audio_dir);
+        Self {
+            audio_dir,
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            bytes_from_disk: AtomicU64::new(0),
+            bytes_from_network: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+            disk: Mutex::new(DiskState {
+                files,
+                pending: Vec::new(),
+            }),
+        }
+    }
+
+    fn lock_disk(&self) -> std::sync::MutexGuard<'_, DiskState> {
+        self.disk
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Records whether the audio for a track the player loaded was cached.
+    fn record_track(&self, cache: &Cache, audio_item: &AudioItem) {
+        let paths: Vec<PathBuf> = audio_item
+            .files
+            .values()
+            .filter_map(|file_id| cache.file_path(*file_id))
+            .collect();
+        if paths.is_empty() {
+            return;
+        }
+        let cached = paths
+            .iter()
+            .find_map(|path| fs::metadata(path).ok().filter(|meta| meta.is_file()));
+        match cached {
+            Some(meta) => {
+                self.hits.fetch_add(1, Ordering::Relaxed);
+                self.bytes_from_disk
+                    .fetch_add(meta.len(), Ordering::Relaxed);
+            }
+            None => {
+                self.misses.fetch_add(1, Ordering::Relaxed);
+                let mut disk = self.lock_disk();
+                disk.pending.extend(paths);
+                let excess = disk.pending.len().saturating_sub(MAX_PENDING_DOWNLOADS);
+                disk.pending.drain(..excess);
+            }
+        }
+    }
+
+    /// Records bytes downloaded into the cache outside of playback, such as by a prefetch.
+    pub(crate) fn record_download(&self, bytes: u64) {
+        self.bytes_from_network.fetch_add(bytes, Ordering::Relaxed);
+        METRICS.prefetch_bytes_downloaded.add(bytes);
+    }
+
+    /// Rescans the audio directory and returns the current counters.
+    pub(crate) fn snapshot(&self) -> cspot_cache_stats_t {
+        let files = scan_audio_dir(&self.audio_dir);
+        let mut disk = self.lock_disk();
+
+        let evicted = disk
+            .files
+            .keys()
+            .filter(|path| !files.contains_key(*path))
+            .count();
+        self.evictions.fetch_add(evicted as u64, Ordering::Relaxed);
+
+        let mut downloaded = 0;
+        disk.pending.retain(|path| match files.get(path) {
+            Some(size) => {
+                downloaded += size;
+                false
+            }
+            None => true,
+        });
+        self.bytes_from_network
+            .fetch_add(downloaded, Ordering::Relaxed);
+
+        let cached_files = files.len() as u64;
+        let cached_bytes = files.values().sum();
+        disk.files = files;
+
+        cspot_cache_stats_t {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            bytes_from_disk: self.bytes_from_disk.load(Ordering::Relaxed),
+            bytes_from_network: self.bytes_from_network.load(Ordering::Relaxed),
+            evictions: self.evictions.load(Ordering::Relaxed),
+            cached_files,
+            cached_bytes,
+        }
+    }
+}
+
+/// Lists the files in librespot's audio cache, which nests them one directory deep.
+fn scan_audio_dir(audio_dir: &Path) -> HashMap<PathBuf, u64> {
+    let mut files = HashMap::new();
+    let mut dirs = vec![(audio_dir.to_path_buf(), 0)];
+    while let Some((dir, depth)) = dirs.pop() {
+        let Ok(entries) = fs::read_dir(&dir) else {
+            continue;
+        };
+        for entry in entries.flatten() {
+            let Ok(meta) = entry.metadata() else {
+                continue;
+            };
+            let path = entry.path();
+            if meta.is_file() {
+                files.insert(path, meta.len());
+            } else if meta.is_dir() && depth == 0 {
+                dirs.push((path, depth + 1));
+            }
+        }
+    }
+    files
+}
+
+/// Counts cache hits and misses for the tracks `player` loads until it is dropped.
+pub(crate) fn watch_player(stats: Arc<CacheStats>, session: &Session, player: &Arc<Player>) {
+    let Some(cache) = session.cache().cloned() else {
+        return;
+    };
+    let mut event_channel = player.get_player_event_channel();
+    runtime().spawn(monitored(TaskKind::CacheStats, async move {
+        while let Some(event) = event_channel.recv().await {
+            if let PlayerEvent::TrackChanged { audio_item } = event {
+                // Checking the cache stats the track's files on disk.
+                let (stats, cache) = (Arc::clone(&stats), cache.clone());
+                let _ = tokio::task::spawn_blocking(move || {
+                    stats.record_track(&cache, &audio_item);
+                })
+                .await;
+            }
+        }
+    }));
+}
+
+/// Initializes a cache configuration with every part of the cache disabled.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_cache_config_init(config: *mut cspot_cache_config_t) {
+    if config.is_null() {
+        return;
+    }
+    // Safety: caller provided a writable config pointer.
+    unsafe {
+        *config = cspot_cache_config_t::default();
+    }
+}
+
+/// Reads the audio cache counters of a session created with `cspot_session_create_with_cache`.
+///
+/// Rescans the audio directory, so avoid calling it from latency-sensitive threads.
+/// Returns false and writes an error if the session has no audio cache.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_cache_stats(
+    session: *const cspot_session_t,
+    out_stats: *mut cspot_cache_stats_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    if session.is_null() {
+        write_error(out_error, "session handle was null");
+        return false;
+    }
+    if out_stats.is_null() {
+        write_error(out_error, "out_stats was null");
+        return false;
+    }
+    let Some(stats) = cache_stats_from_handle(session) else {
+        write_error(out_error, "session has no audio cache");
+        return false;
+    };
+    // Safety: out_stats is non-null and points to writable memory.
+    unsafe {
+        *out_stats = stats.snapshot();
+    }
+    true
+}
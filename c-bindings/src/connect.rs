@@ -1,25 +1,40 @@
 //! C bindings for librespot connect (Spirc).
 
 use std::future::Future;
-use std::os::raw::c_char;
+use std::mem;
+use std::os::raw::{c_char, c_int, c_void};
 use std::panic::AssertUnwindSafe;
 use std::pin::Pin;
 use std::ptr;
-use std::sync::{Arc, Mutex};
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, AtomicU16, Ordering};
 use std::time::Instant;
 
+use arc_swap::ArcSwap;
+use once_cell::sync::Lazy;
+
 use librespot::connect::{ConnectConfig, LoadRequest, LoadRequestOptions, Spirc};
-use librespot::core::{Error as LibrespotError, SpotifyUri};
-use librespot::metadata::audio::{AudioItem, UniqueFields};
+use librespot::core::{Error as LibrespotError, SpotifyUri, session::Session};
+use librespot::discovery::Credentials;
+use librespot::metadata::audio::AudioItem;
+use librespot::playback::mixer::Mixer;
 use librespot::playback::player::{Player, PlayerEvent};
 use tokio::task::JoinHandle;
 
+use crate::async_op::{cspot_async_callback_t, cspot_async_op_t, spawn_async_op, take_async_value};
 use crate::discovery::{credentials_from_handle, cspot_device_type_t};
 use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
-use crate::ffi::read_cstr;
+use crate::events::{EventDispatcher, cspot_event_callback_t, cspot_event_kind_t, cspot_event_t};
+use crate::ffi::{read_cstr, read_cstr_array};
+use crate::metadata::{
+    TrackMetadata, cspot_metadata_t, metadata_for_audio_item, metadata_into_handle,
+};
+use crate::metrics::{PlayerEventMetrics, SpircMetrics};
 use crate::playback::{cspot_mixer_t, cspot_player_t, mixer_from_handle, player_from_handle};
 use crate::runtime::runtime;
+use crate::runtime_stats::{TaskKind, monitored};
 use crate::session::{cspot_session_t, session_from_handle};
+use crate::trace;
 
 /// Opaque connect configuration handle for C callers.
 #[allow(non_camel_case_types)]
@@ -39,6 +54,7 @@ pub struct cspot_spirc_task_t;
 
 /// Current playback state reported by cspot.
 #[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
 #[repr(C)]
 pub enum cspot_playback_state_t {
     CSPOT_PLAYBACK_STATE_STOPPED = 0,
@@ -48,6 +64,34 @@ pub enum cspot_playback_state_t {
     CSPOT_PLAYBACK_STATE_INVALID = -1,
 }
 
+/// Playback status snapshot filled by `cspot_spirc_get_status`.
+///
+/// Initialize with `cspot_spirc_status_init` before first use and release with
+/// `cspot_spirc_status_release`. String fields point into `storage`, are null when
+/// unavailable, and remain valid until the next `cspot_spirc_get_status` or
+/// `cspot_spirc_status_release` call on the same struct. `storage` and
+/// `storage_capacity` are owned by cspot and must not be modified.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+pub struct cspot_spirc_status_t {
+    pub connected: bool,
+    pub playback_state: cspot_playback_state_t,
+    pub position_ms: u32,
+    pub duration_ms: u32,
+    pub volume: u16,
+    pub shuffle_enabled: bool,
+    pub repeat_context_enabled: bool,
+    pub repeat_track_enabled: bool,
+    pub track_id: *const c_char,
+    pub track_uri: *const c_char,
+    pub artist: *const c_char,
+    pub album: *const c_char,
+    pub artwork_url: *const c_char,
+    pub title: *const c_char,
+    pub storage: *mut c_char,
+    pub storage_capacity: usize,
+}
+
 #[derive(Clone, Copy, Debug, Eq, PartialEq)]
 enum PlaybackState {
     Stopped,
@@ -73,149 +117,146 @@ impl From<PlaybackState> for cspot_playback_state_t {
     }
 }
 
-#[derive(Clone, Debug, Default)]
-struct TrackMetadata {
-    spotify_id: Option<String>,
-    uri: Option<String>,
-    artist: Option<String>,
-    album: Option<String>,
-    artwork_url: Option<String>,
-    title: Option<String>,
-    duration_ms: u32,
-}
+/// Reference point for position anchors published as microsecond offsets.
+static STATUS_EPOCH: Lazy<Instant> = Lazy::new(Instant::now);
 
-#[derive(Clone, Debug, Default)]
-struct SpircStatusSnapshot {
-    connected: bool,
-    playback_state: PlaybackState,
-    position_ms: u32,
-    duration_ms: u32,
-    volume: u16,
-    shuffle_enabled: bool,
-    repeat_context_enabled: bool,
-    repeat_track_enabled: bool,
-    track: TrackMetadata,
+fn micros_since_epoch(instant: Instant) -> u64 {
+    u64::try_from(instant.saturating_duration_since(*STATUS_EPOCH).as_micros()).unwrap_or(u64::MAX)
 }
 
-#[derive(Debug, Default)]
-struct SpircRuntimeStatus {
-    connected: bool,
+/// Playback position reference published by the status task.
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+struct PositionAnchor {
     playback_state: PlaybackState,
-    position_anchor_ms: u32,
-    position_anchor_at: Option<Instant>,
-    volume: u16,
-    shuffle_enabled: bool,
-    repeat_context_enabled: bool,
-    repeat_track_enabled: bool,
-    track: TrackMetadata,
+    position_ms: u32,
+    anchored_at_us: Option<u64>,
 }
 
-impl SpircRuntimeStatus {
-    fn snapshot(&self) -> SpircStatusSnapshot {
-        SpircStatusSnapshot {
-            connected: self.connected,
-            playback_state: self.playback_state,
-            position_ms: self.current_position_ms(),
-            duration_ms: self.track.duration_ms,
-            volume: self.volume,
-            shuffle_enabled: self.shuffle_enabled,
-            repeat_context_enabled: self.repeat_context_enabled,
-            repeat_track_enabled: self.repeat_track_enabled,
-            track: self.track.clone(),
-        }
-    }
-
-    fn current_position_ms(&self) -> u32 {
-        let mut position_ms = self.position_anchor_ms;
+impl PositionAnchor {
+    fn current_position_ms(&self, duration_ms: u32) -> u32 {
+        let mut position_ms = self.position_ms;
         if self.playback_state == PlaybackState::Playing {
-            if let Some(anchor) = self.position_anchor_at {
-                let elapsed_ms = u32::try_from(anchor.elapsed().as_millis()).unwrap_or(u32::MAX);
+            if let Some(anchored_at_us) = self.anchored_at_us {
+                let now_us = micros_since_epoch(Instant::now());
+                let elapsed_ms = now_us.saturating_sub(anchored_at_us) / 1000;
+                let elapsed_ms = u32::try_from(elapsed_ms).unwrap_or(u32::MAX);
                 position_ms = position_ms.saturating_add(elapsed_ms);
             }
         }
-        if self.track.duration_ms > 0 {
-            position_ms.min(self.track.duration_ms)
+        if duration_ms > 0 {
+            position_ms.min(duration_ms)
         } else {
             position_ms
         }
     }
+}
 
+/// Status state owned by the status task, which is its only writer.
+#[derive(Clone, Debug, Default)]
+struct SpircRuntimeStatus {
+    connected: bool,
+    anchor: PositionAnchor,
+    volume: u16,
+    shuffle_enabled: bool,
+    repeat_context_enabled: bool,
+    repeat_track_enabled: bool,
+    track: Arc<TrackMetadata>,
+}
+
+impl SpircRuntimeStatus {
     fn set_playback_state(&mut self, playback_state: PlaybackState) {
-        self.playback_state = playback_state;
+        self.anchor.playback_state = playback_state;
         if playback_state != PlaybackState::Playing {
-            self.position_anchor_at = None;
+            self.anchor.anchored_at_us = None;
         }
     }
 
     fn set_position(&mut self, position_ms: u32, is_playing: bool) {
-        let position_ms = if self.track.duration_ms > 0 {
-            position_ms.min(self.track.duration_ms)
+        let duration_ms = self.track.duration_ms;
+        self.anchor.position_ms = if duration_ms > 0 {
+            position_ms.min(duration_ms)
         } else {
             position_ms
         };
-        self.position_anchor_ms = position_ms;
-        self.position_anchor_at = if is_playing {
-            Some(Instant::now())
-        } else {
-            None
-        };
+        self.anchor.anchored_at_us = is_playing.then(|| micros_since_epoch(Instant::now()));
     }
 
     fn set_track_identity(&mut self, track_uri: &SpotifyUri) {
         let uri = track_uri.to_uri();
-        if self.track.uri.as_deref() != Some(uri.as_str()) {
-            self.track.artist = None;
-            self.track.album = None;
-            self.track.artwork_url = None;
-            self.track.title = None;
-            self.track.duration_ms = 0;
+        if self.track.uri() != Some(uri.as_str()) {
+            self.track = Arc::new(TrackMetadata::identity(track_uri));
         }
-        self.track.spotify_id = spotify_item_id(track_uri);
-        self.track.uri = Some(uri);
     }
 
     fn set_track_metadata(&mut self, audio_item: &AudioItem) {
-        self.track.spotify_id = spotify_item_id(&audio_item.track_id);
-        self.track.uri = non_empty(audio_item.uri.clone());
-        self.track.title = non_empty(audio_item.name.clone());
-        self.track.artwork_url = audio_item
-            .covers
-            .first()
-            .map(|cover| cover.url.clone())
-            .and_then(non_empty);
-        self.track.duration_ms = audio_item.duration_ms;
-
-        let (artist, album) = match &audio_item.unique_fields {
-            UniqueFields::Track { artists, album, .. } => {
-                let mut names = Vec::new();
-                for artist in artists.iter() {
-                    if artist.name.is_empty() {
-                        continue;
-                    }
-                    if !names.iter().any(|value: &String| value == &artist.name) {
-                        names.push(artist.name.clone());
-                    }
-                }
-                (
-                    (!names.is_empty()).then(|| names.join(", ")),
-                    non_empty(album.clone()),
-                )
-            }
-            UniqueFields::Local { artists, album, .. } => (
-                artists.clone().and_then(non_empty),
-                album.clone().and_then(non_empty),
-            ),
-            UniqueFields::Episode { show_name, .. } => (None, non_empty(show_name.clone())),
-        };
-        self.track.artist = artist;
-        self.track.album = album;
+        self.track = metadata_for_audio_item(audio_item);
+        let duration_ms = self.track.duration_ms;
+        if self.anchor.position_ms > duration_ms && duration_ms > 0 {
+            self.anchor.position_ms = duration_ms;
+        }
+    }
+}
 
-        if self.position_anchor_ms > self.track.duration_ms && self.track.duration_ms > 0 {
-            self.position_anchor_ms = self.track.duration_ms;
+/// Lock-free view of `SpircRuntimeStatus` shared with C getters.
+///
+/// Scalars are published through atomics. The position anchor and track metadata are
+/// immutable records swapped atomically whenever they change, so readers always see
+/// a consistent anchor and never wait on the writer.
+struct SpircStatusCell {
+    connected: AtomicBool,
+    volume: AtomicU16,
+    shuffle_enabled: AtomicBool,
+    repeat_context_enabled: AtomicBool,
+    repeat_track_enabled: AtomicBool,
+    anchor: ArcSwap<PositionAnchor>,
+    track: ArcSwap<TrackMetadata>,
+}
+
+impl Default for SpircStatusCell {
+    fn default() -> Self {
+        Self {
+            connected: AtomicBool::new(false),
+            volume: AtomicU16::new(0),
+            shuffle_enabled: AtomicBool::new(false),
+            repeat_context_enabled: AtomicBool::new(false),
+            repeat_track_enabled: AtomicBool::new(false),
+            anchor: ArcSwap::from_pointee(PositionAnchor::default()),
+            track: ArcSwap::from_pointee(TrackMetadata::default()),
         }
     }
 }
 
+impl SpircStatusCell {
+    fn publish(&self, status: &SpircRuntimeStatus) {
+        self.connected.store(status.connected, Ordering::Relaxed);
+        self.volume.store(status.volume, Ordering::Relaxed);
+        self.shuffle_enabled
+            .store(status.shuffle_enabled, Ordering::Relaxed);
+        self.repeat_context_enabled
+            .store(status.repeat_context_enabled, Ordering::Relaxed);
+        self.repeat_track_enabled
+            .store(status.repeat_track_enabled, Ordering::Relaxed);
+
+        // The track goes first so readers that load the anchor before the track never
+        // see a new anchor with the previous track.
+        if !Arc::ptr_eq(&self.track.load(), &status.track) {
+            self.track.store(Arc::clone(&status.track));
+        }
+
+        if **self.anchor.load() != status.anchor {
+            self.anchor.store(Arc::new(status.anchor));
+        }
+    }
+
+    fn anchor(&self) -> PositionAnchor {
+        **self.anchor.load()
+    }
+
+    fn track(&self) -> Arc<TrackMetadata> {
+        self.track.load_full()
+    }
+}
+
 struct ConnectConfigHandle {
     config: ConnectConfig,
 }
@@ -226,29 +267,16 @@ struct LoadRequestOptionsHandle {
 
 struct SpircHandle {
     spirc: Spirc,
-    status: Arc<Mutex<SpircRuntimeStatus>>,
+    status: Arc<SpircStatusCell>,
+    events: Arc<EventDispatcher>,
     status_task: JoinHandle<()>,
+    metrics: Arc<SpircMetrics>,
 }
 
 struct SpircTaskHandle {
     task: Option<Pin<Box<dyn Future<Output = ()> + Send>>>,
 }
 
-fn non_empty(value: String) -> Option<String> {
-    if value.trim().is_empty() {
-        None
-    } else {
-        Some(value)
-    }
-}
-
-fn spotify_item_id(uri: &SpotifyUri) -> Option<String> {
-    match uri {
-        SpotifyUri::Track { id } | SpotifyUri::Episode { id } => Some(id.to_base62()),
-        _ => None,
-    }
-}
-
 fn apply_player_event(status: &mut SpircRuntimeStatus, event: PlayerEvent) {
     match event {
         PlayerEvent::SessionConnected { .. } => status.connected = true,
@@ -297,7 +325,7 @@ fn apply_player_event(status: &mut SpircRuntimeStatus, event: PlayerEvent) {
             ..
         } => {
             status.set_track_identity(&track_id);
-            let is_playing = status.playback_state == PlaybackState::Playing;
+            let is_playing = status.anchor.playback_state == PlaybackState::Playing;
             status.set_position(position_ms, is_playing);
         }
         PlayerEvent::Stopped { track_id, .. } => {
@@ -315,17 +343,82 @@ fn apply_player_event(status: &mut SpircRuntimeStatus, event: PlayerEvent) {
     }
 }
 
+fn event_record(kind: cspot_event_kind_t, status: &SpircRuntimeStatus) -> cspot_event_t {
+    cspot_event_t {
+        kind,
+        playback_state: status.anchor.playback_state.into(),
+        position_ms: status.anchor.current_position_ms(status.track.duration_ms),
+        duration_ms: status.track.duration_ms,
+        volume: status.volume,
+        connected: status.connected,
+        shuffle_enabled: status.shuffle_enabled,
+        repeat_context_enabled: status.repeat_context_enabled,
+        repeat_track_enabled: status.repeat_track_enabled,
+    }
+}
+
+/// Reports the changes between two status states as typed events.
+fn emit_status_changes(
+    previous: &SpircRuntimeStatus,
+    current: &SpircRuntimeStatus,
+    seeked: bool,
+    mut emit: impl FnMut(cspot_event_t),
+) {
+    use cspot_event_kind_t::*;
+
+    if previous.connected != current.connected {
+        let kind = if current.connected {
+            CSPOT_EVENT_SESSION_CONNECTED
+        } else {
+            CSPOT_EVENT_SESSION_DISCONNECTED
+        };
+        emit(event_record(kind, current));
+    }
+    if !Arc::ptr_eq(&previous.track, &current.track) {
+        emit(event_record(CSPOT_EVENT_TRACK_CHANGED, current));
+    }
+    if previous.anchor.playback_state != current.anchor.playback_state {
+        emit(event_record(CSPOT_EVENT_PLAYBACK_STATE_CHANGED, current));
+    }
+    if seeked {
+        emit(event_record(CSPOT_EVENT_SEEKED, current));
+    }
+    if previous.volume != current.volume {
+        emit(event_record(CSPOT_EVENT_VOLUME_CHANGED, current));
+    }
+    if previous.shuffle_enabled != current.shuffle_enabled {
+        emit(event_record(CSPOT_EVENT_SHUFFLE_CHANGED, current));
+    }
+    if previous.repeat_context_enabled != current.repeat_context_enabled
+        || previous.repeat_track_enabled != current.repeat_track_enabled
+    {
+        emit(event_record(CSPOT_EVENT_REPEAT_CHANGED, current));
+    }
+}
+
 fn spawn_status_task(
     player: &Arc<Player>,
-    status: Arc<Mutex<SpircRuntimeStatus>>,
+    cell: Arc<SpircStatusCell>,
+    events: Arc<EventDispatcher>,
+    metrics: Arc<SpircMetrics>,
 ) -> JoinHandle<()> {
     let mut event_channel = player.get_player_event_channel();
-    runtime().spawn(async move {
+    let task = async move {
+        let mut status = SpircRuntimeStatus::default();
+        let mut metrics = PlayerEventMetrics::new(metrics);
         while let Some(event) = event_channel.recv().await {
-            let mut guard = status.lock().unwrap_or_else(|err| err.into_inner());
-            apply_player_event(&mut guard, event);
+            metrics.observe(&event);
+            let previous = status.clone();
+            let seeked = matches!(
+                event,
+                PlayerEvent::Seeked { .. } | PlayerEvent::PositionCorrection { .. }
+            );
+            apply_player_event(&mut status, event);
+            cell.publish(&status);
+            emit_status_changes(&previous, &status, seeked, |event| events.dispatch(&event));
         }
-    })
+    };
+    runtime().spawn(monitored(TaskKind::SpircStatus, task))
 }
 
 fn run_spirc_command(
@@ -340,7 +433,12 @@ fn run_spirc_command(
     }
     // Safety: spirc must be a valid handle allocated by cspot.
     let handle = unsafe { &*(spirc as *const SpircHandle) };
-    match command(&handle.spirc) {
+    let start = Instant::now();
+    let result = command(&handle.spirc);
+    handle
+        .metrics
+        .record_command(start.elapsed(), result.is_ok());
+    match result {
         Ok(()) => true,
         Err(err) => {
             write_error(out_error, err.to_string());
@@ -349,23 +447,95 @@ fn run_spirc_command(
     }
 }
 
-fn snapshot_from_spirc(spirc: *const cspot_spirc_t) -> Option<SpircStatusSnapshot> {
+fn status_from_spirc<'a>(spirc: *const cspot_spirc_t) -> Option<&'a SpircStatusCell> {
     if spirc.is_null() {
         return None;
     }
-    // Safety: spirc must be a valid handle allocated by cspot.
+    // Safety: spirc must be a valid handle allocated by cspot and outlives the call.
     let handle = unsafe { &*(spirc as *const SpircHandle) };
-    let guard = handle.status.lock().unwrap_or_else(|err| err.into_inner());
-    Some(guard.snapshot())
+    Some(&handle.status)
 }
 
-fn string_to_owned_ptr(value: Option<String>) -> *mut c_char {
-    match value {
-        Some(value) => cstring_from_str_lossy(&value).into_raw(),
+fn track_string_from_spirc(
+    spirc: *const cspot_spirc_t,
+    field: impl FnOnce(&TrackMetadata) -> Option<&str>,
+) -> *mut c_char {
+    match status_from_spirc(spirc) {
+        Some(cell) => track_string(cell, field),
         None => ptr::null_mut(),
     }
 }
 
+fn track_string(
+    cell: &SpircStatusCell,
+    field: impl FnOnce(&TrackMetadata) -> Option<&str>,
+) -> *mut c_char {
+    match field(&cell.track()) {
+        Some(value) => cstring_from_str_lossy(value).into_raw(),
+        None => ptr::null_mut(),
+    }
+}
+
+fn empty_status() -> cspot_spirc_status_t {
+    cspot_spirc_status_t {
+        connected: false,
+        playback_state: cspot_playback_state_t::CSPOT_PLAYBACK_STATE_INVALID,
+        position_ms: 0,
+        duration_ms: 0,
+        volume: 0,
+        shuffle_enabled: false,
+        repeat_context_enabled: false,
+        repeat_track_enabled: false,
+        track_id: ptr::null(),
+        track_uri: ptr::null(),
+        artist: ptr::null(),
+        album: ptr::null(),
+        artwork_url: ptr::null(),
+        title: ptr::null(),
+        storage: ptr::null_mut(),
+        storage_capacity: 0,
+    }
+}
+
+fn take_status_storage(status: &mut cspot_spirc_status_t) -> Vec<u8> {
+    let storage = mem::replace(&mut status.storage, ptr::null_mut());
+    let capacity = mem::replace(&mut status.storage_capacity, 0);
+    if storage.is_null() || capacity == 0 {
+        return Vec::new();
+    }
+    // Safety: storage and capacity were produced by `store_status_storage` from a Vec<u8>.
+    unsafe { Vec::from_raw_parts(storage as *mut u8, 0, capacity) }
+}
+
+fn store_status_storage(status: &mut cspot_spirc_status_t, storage: Vec<u8>) {
+    let mut storage = mem::ManuallyDrop::new(storage);
+    if storage.capacity() == 0 {
+        return;
+    }
+    status.storage = storage.as_mut_ptr() as *mut c_char;
+    status.storage_capacity = storage.capacity();
+}
+
+/// Appends `value` as a NUL-terminated string and returns its offset in `storage`.
+fn push_status_string(storage: &mut Vec<u8>, value: Option<&str>) -> Option<usize> {
+    let value = value?;
+    let offset = storage.len();
+    storage.extend(
+        value
+            .bytes()
+            .map(|byte| if byte == 0 { b' ' } else { byte }),
+    );
+    storage.push(0);
+    Some(offset)
+}
+
+fn status_string_ptr(storage: &[u8], offset: Option<usize>) -> *const c_char {
+    match offset {
+        Some(offset) => storage[offset..].as_ptr() as *const c_char,
+        None => ptr::null(),
+    }
+}
+
 /// Creates a connect configuration using default values.
 ///
 /// The returned handle must be released with `cspot_connect_config_free`.
@@ -488,58 +658,56 @@ pub extern "C" fn cspot_load_request_options_free(options: *mut cspot_load_reque
     }
 }
 
-/// Creates a new Spirc instance and returns the associated task handle.
-///
-/// The returned spirc handle must be released with `cspot_spirc_free`.
-/// The task handle must be released with `cspot_spirc_task_free`.
-/// The configuration and credentials are cloned; callers may free their handles
-/// after this function returns.
-#[unsafe(no_mangle)]
-pub extern "C" fn cspot_spirc_create(
+/// Arguments for starting a Spirc instance, cloned out of their C handles.
+struct SpircStartArgs {
+    config: ConnectConfig,
+    session: Session,
+    credentials: Credentials,
+    player: Arc<Player>,
+    mixer: Arc<dyn Mixer>,
+}
+
+/// Handles for a started Spirc instance that have not been handed to C yet.
+struct SpircStarted {
+    spirc: SpircHandle,
+    task: SpircTaskHandle,
+}
+
+fn spirc_start_args(
     config: *const cspot_connect_config_t,
     session: *const cspot_session_t,
     credentials: *const crate::discovery::cspot_credentials_t,
     player: *const cspot_player_t,
     mixer: *const cspot_mixer_t,
-    out_task: *mut *mut cspot_spirc_task_t,
     out_error: *mut *mut cspot_error_t,
-) -> *mut cspot_spirc_t {
-    clear_error(out_error);
-    if out_task.is_null() {
-        write_error(out_error, "out_task was null");
-        return ptr::null_mut();
-    }
-    // Safety: out_task is non-null and points to writable memory.
-    unsafe {
-        *out_task = ptr::null_mut();
-    }
+) -> Option<SpircStartArgs> {
     if config.is_null() {
         write_error(out_error, "config handle was null");
-        return ptr::null_mut();
+        return None;
     }
     let session = match session_from_handle(session) {
         Some(value) => value,
         None => {
             write_error(out_error, "session handle was null");
-            return ptr::null_mut();
+            return None;
         }
     };
     if credentials.is_null() {
         write_error(out_error, "credentials handle was null");
-        return ptr::null_mut();
+        return None;
     }
     let player = match player_from_handle(player) {
         Some(value) => value,
         None => {
             write_error(out_error, "player handle was null");
-            return ptr::null_mut();
+            return None;
         }
     };
     let mixer = match mixer_from_handle(mixer) {
         Some(value) => value,
         None => {
             write_error(out_error, "mixer handle was null");
-            return ptr::null_mut();
+            return None;
         }
     };
 
@@ -549,35 +717,101 @@ pub extern "C" fn cspot_spirc_create(
         Some(value) => value,
         None => {
             write_error(out_error, "credentials handle was null");
-            return ptr::null_mut();
+            return None;
         }
     };
-    let config = config_handle.config.clone();
-    let spirc_player = Arc::clone(&player);
+    Some(SpircStartArgs {
+        config: config_handle.config.clone(),
+        session,
+        credentials,
+        player,
+        mixer,
+    })
+}
 
-    let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime()
-            .block_on(async { Spirc::new(config, session, credentials, spirc_player, mixer).await })
-    }));
+/// Connects a Spirc instance; must run inside the cspot runtime.
+async fn start_spirc(args: SpircStartArgs) -> Result<SpircStarted, LibrespotError> {
+    let spirc_player = Arc::clone(&args.player);
+    let metrics = SpircMetrics::register(args.config.name.clone());
+    // Covers the access point connection and login as well as Connect setup.
+    let connect_span = trace::async_span("startup", "spirc.connect");
+    let (spirc, task) = Spirc::new(
+        args.config,
+        args.session,
+        args.credentials,
+        spirc_player,
+        args.mixer,
+    )
+    .await?;
+    drop(connect_span);
+    let status = Arc::new(SpircStatusCell::default());
+    let events = Arc::new(EventDispatcher::default());
+    let status_task = spawn_status_task(
+        &args.player,
+        Arc::clone(&status),
+        Arc::clone(&events),
+        Arc::clone(&metrics),
+    );
+    Ok(SpircStarted {
+        spirc: SpircHandle {
+            spirc,
+            status,
+            events,
+            status_task,
+            metrics,
+        },
+        task: SpircTaskHandle {
+            task: Some(Box::pin(task)),
+        },
+    })
+}
+
+fn write_spirc_started(
+    started: SpircStarted,
+    out_task: *mut *mut cspot_spirc_task_t,
+) -> *mut cspot_spirc_t {
+    // Safety: out_task is non-null and points to writable memory.
+    unsafe {
+        *out_task = Box::into_raw(Box::new(started.task)) as *mut cspot_spirc_task_t;
+    }
+    Box::into_raw(Box::new(started.spirc)) as *mut cspot_spirc_t
+}
+
+/// Creates a new Spirc instance and returns the associated task handle.
+///
+/// The returned spirc handle must be released with `cspot_spirc_free`.
+/// The task handle must be released with `cspot_spirc_task_free`.
+/// The configuration and credentials are cloned; callers may free their handles
+/// after this function returns.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_create(
+    config: *const cspot_connect_config_t,
+    session: *const cspot_session_t,
+    credentials: *const crate::discovery::cspot_credentials_t,
+    player: *const cspot_player_t,
+    mixer: *const cspot_mixer_t,
+    out_task: *mut *mut cspot_spirc_task_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_spirc_t {
+    clear_error(out_error);
+    if out_task.is_null() {
+        write_error(out_error, "out_task was null");
+        return ptr::null_mut();
+    }
+    // Safety: out_task is non-null and points to writable memory.
+    unsafe {
+        *out_task = ptr::null_mut();
+    }
+    let args = match spirc_start_args(config, session, credentials, player, mixer, out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+
+    let result =
+        std::panic::catch_unwind(AssertUnwindSafe(|| runtime().block_on(start_spirc(args))));
 
     match result {
-        Ok(Ok((spirc, task))) => {
-            let status = Arc::new(Mutex::new(SpircRuntimeStatus::default()));
-            let status_task = spawn_status_task(&player, Arc::clone(&status));
-            let spirc_handle = Box::new(SpircHandle {
-                spirc,
-                status,
-                status_task,
-            });
-            let task_handle = Box::new(SpircTaskHandle {
-                task: Some(Box::pin(task)),
-            });
-            // Safety: out_task is non-null and points to writable memory.
-            unsafe {
-                *out_task = Box::into_raw(task_handle) as *mut cspot_spirc_task_t;
-            }
-            Box::into_raw(spirc_handle) as *mut cspot_spirc_t
-        }
+        Ok(Ok(started)) => write_spirc_started(started, out_task),
         Ok(Err(err)) => {
             write_error(out_error, err.to_string());
             ptr::null_mut()
@@ -589,6 +823,60 @@ pub extern "C" fn cspot_spirc_create(
     }
 }
 
+/// Creates a new Spirc instance without blocking.
+///
+/// Returns an operation handle that completes once Connect is established; claim the
+/// spirc and task handles with `cspot_async_op_take_spirc`. Arguments are cloned as in
+/// `cspot_spirc_create`, so callers may free their handles after this returns. The
+/// operation handle must be released with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_create_async(
+    config: *const cspot_connect_config_t,
+    session: *const cspot_session_t,
+    credentials: *const crate::discovery::cspot_credentials_t,
+    player: *const cspot_player_t,
+    mixer: *const cspot_mixer_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let args = match spirc_start_args(config, session, credentials, player, mixer, out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+    spawn_async_op(
+        async move { start_spirc(args).await.map_err(|err| err.to_string()) },
+        callback,
+        user_data,
+    )
+}
+
+/// Claims the spirc and task handles produced by `cspot_spirc_create_async`.
+///
+/// Returns null and writes an error if the operation has not completed successfully.
+/// The handles must be released as described for `cspot_spirc_create`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_spirc(
+    op: *const cspot_async_op_t,
+    out_task: *mut *mut cspot_spirc_task_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_spirc_t {
+    clear_error(out_error);
+    if out_task.is_null() {
+        write_error(out_error, "out_task was null");
+        return ptr::null_mut();
+    }
+    // Safety: out_task is non-null and points to writable memory.
+    unsafe {
+        *out_task = ptr::null_mut();
+    }
+    match take_async_value::<SpircStarted>(op, out_error) {
+        Some(started) => write_spirc_started(started, out_task),
+        None => ptr::null_mut(),
+    }
+}
+
 /// Sends a Connect activate command.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_activate(
@@ -777,21 +1065,9 @@ pub extern "C" fn cspot_spirc_load_tracks(
     out_error: *mut *mut cspot_error_t,
 ) -> bool {
     clear_error(out_error);
-    if uri_count > 0 && uris.is_null() {
-        write_error(out_error, "uris was null");
+    let Some(tracks) = read_cstr_array(uris, uri_count, "uri", out_error) else {
         return false;
-    }
-
-    let mut tracks = Vec::with_capacity(uri_count);
-    for index in 0..uri_count {
-        // Safety: uris is valid for uri_count entries.
-        let uri_ptr = unsafe { *uris.add(index) };
-        let uri = match read_cstr(uri_ptr, "uri", out_error) {
-            Some(value) => value,
-            None => return false,
-        };
-        tracks.push(uri);
-    }
+    };
 
     let options = if options.is_null() {
         LoadRequestOptions::default()
@@ -808,8 +1084,8 @@ pub extern "C" fn cspot_spirc_load_tracks(
 /// Reports whether the connect session is currently active/connected.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_is_connected(spirc: *const cspot_spirc_t) -> bool {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.connected,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.connected.load(Ordering::Relaxed),
         None => false,
     }
 }
@@ -819,8 +1095,8 @@ pub extern "C" fn cspot_spirc_is_connected(spirc: *const cspot_spirc_t) -> bool
 pub extern "C" fn cspot_spirc_playback_state(
     spirc: *const cspot_spirc_t,
 ) -> cspot_playback_state_t {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.playback_state.into(),
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.anchor().playback_state.into(),
         None => cspot_playback_state_t::CSPOT_PLAYBACK_STATE_INVALID,
     }
 }
@@ -828,8 +1104,8 @@ pub extern "C" fn cspot_spirc_playback_state(
 /// Returns the current playback position in milliseconds.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_position_ms(spirc: *const cspot_spirc_t) -> u32 {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.position_ms,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.anchor().current_position_ms(cell.track().duration_ms),
         None => 0,
     }
 }
@@ -837,8 +1113,8 @@ pub extern "C" fn cspot_spirc_current_position_ms(spirc: *const cspot_spirc_t) -
 /// Returns the current track duration in milliseconds.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_duration_ms(spirc: *const cspot_spirc_t) -> u32 {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.duration_ms,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.track().duration_ms,
         None => 0,
     }
 }
@@ -846,8 +1122,8 @@ pub extern "C" fn cspot_spirc_current_track_duration_ms(spirc: *const cspot_spir
 /// Returns the current volume.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_volume(spirc: *const cspot_spirc_t) -> u16 {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.volume,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.volume.load(Ordering::Relaxed),
         None => 0,
     }
 }
@@ -855,8 +1131,8 @@ pub extern "C" fn cspot_spirc_current_volume(spirc: *const cspot_spirc_t) -> u16
 /// Returns whether shuffle mode is currently enabled.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_is_shuffle_enabled(spirc: *const cspot_spirc_t) -> bool {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.shuffle_enabled,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.shuffle_enabled.load(Ordering::Relaxed),
         None => false,
     }
 }
@@ -864,8 +1140,8 @@ pub extern "C" fn cspot_spirc_is_shuffle_enabled(spirc: *const cspot_spirc_t) ->
 /// Returns whether repeat-context mode is currently enabled.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_is_repeat_context_enabled(spirc: *const cspot_spirc_t) -> bool {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.repeat_context_enabled,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.repeat_context_enabled.load(Ordering::Relaxed),
         None => false,
     }
 }
@@ -873,19 +1149,103 @@ pub extern "C" fn cspot_spirc_is_repeat_context_enabled(spirc: *const cspot_spir
 /// Returns whether repeat-track mode is currently enabled.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_is_repeat_track_enabled(spirc: *const cspot_spirc_t) -> bool {
-    match snapshot_from_spirc(spirc) {
-        Some(snapshot) => snapshot.repeat_track_enabled,
+    match status_from_spirc(spirc) {
+        Some(cell) => cell.repeat_track_enabled.load(Ordering::Relaxed),
         None => false,
     }
 }
 
+/// Initializes a status snapshot so it can be passed to `cspot_spirc_get_status`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_status_init(status: *mut cspot_spirc_status_t) {
+    if status.is_null() {
+        return;
+    }
+    // Safety: caller provided a writable status pointer.
+    unsafe {
+        ptr::write(status, empty_status());
+    }
+}
+
+/// Fills `status` with the current playback status and track metadata.
+///
+/// Fields are read without locking. String storage from a previous
+/// call on the same struct is reused when large enough, so steady-state refreshes
+/// do not allocate. Returns false if either pointer is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_get_status(
+    spirc: *const cspot_spirc_t,
+    status: *mut cspot_spirc_status_t,
+) -> bool {
+    if spirc.is_null() || status.is_null() {
+        return false;
+    }
+    // Safety: spirc must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(spirc as *const SpircHandle) };
+    // Safety: status must be initialized with `cspot_spirc_status_init`.
+    let status = unsafe { &mut *status };
+    fill_status(&handle.status, status);
+    true
+}
+
+fn fill_status(cell: &SpircStatusCell, status: &mut cspot_spirc_status_t) {
+    // The anchor is loaded first: `publish` stores the track before the anchor, so a
+    // new anchor is never paired with the previous track.
+    let anchor = cell.anchor();
+    let track = cell.track();
+
+    let fields = [
+        track.spotify_id(),
+        track.uri(),
+        track.artist(),
+        track.album(),
+        track.artwork_url(),
+        track.title(),
+    ];
+    let required: usize = fields.iter().flatten().map(|value| value.len() + 1).sum();
+    let mut storage = take_status_storage(status);
+    if storage.capacity() < required {
+        storage = Vec::with_capacity(required);
+    }
+
+    status.connected = cell.connected.load(Ordering::Relaxed);
+    status.playback_state = anchor.playback_state.into();
+    status.position_ms = anchor.current_position_ms(track.duration_ms);
+    status.duration_ms = track.duration_ms;
+    status.volume = cell.volume.load(Ordering::Relaxed);
+    status.shuffle_enabled = cell.shuffle_enabled.load(Ordering::Relaxed);
+    status.repeat_context_enabled = cell.repeat_context_enabled.load(Ordering::Relaxed);
+    status.repeat_track_enabled = cell.repeat_track_enabled.load(Ordering::Relaxed);
+    let offsets = fields.map(|value| push_status_string(&mut storage, value));
+
+    let [track_id, track_uri, artist, album, artwork_url, title] = offsets;
+    status.track_id = status_string_ptr(&storage, track_id);
+    status.track_uri = status_string_ptr(&storage, track_uri);
+    status.artist = status_string_ptr(&storage, artist);
+    status.album = status_string_ptr(&storage, album);
+    status.artwork_url = status_string_ptr(&storage, artwork_url);
+    status.title = status_string_ptr(&storage, title);
+    store_status_storage(status, storage);
+}
+
+/// Releases string storage held by a status snapshot and resets it to its initial state.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_status_release(status: *mut cspot_spirc_status_t) {
+    if status.is_null() {
+        return;
+    }
+    // Safety: status must be initialized with `cspot_spirc_status_init`.
+    let status = unsafe { &mut *status };
+    drop(take_status_storage(status));
+    *status = empty_status();
+}
+
 /// Returns the current track Spotify ID, if available.
 ///
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_id(spirc: *const cspot_spirc_t) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.spotify_id);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.spotify_id())
 }
 
 /// Returns the current track Spotify URI, if available.
@@ -893,8 +1253,7 @@ pub extern "C" fn cspot_spirc_current_track_id(spirc: *const cspot_spirc_t) -> *
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_uri(spirc: *const cspot_spirc_t) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.uri);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.uri())
 }
 
 /// Returns the current track artist list, if available.
@@ -902,8 +1261,7 @@ pub extern "C" fn cspot_spirc_current_track_uri(spirc: *const cspot_spirc_t) ->
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_artist(spirc: *const cspot_spirc_t) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.artist);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.artist())
 }
 
 /// Returns the current track album or show name, if available.
@@ -911,8 +1269,7 @@ pub extern "C" fn cspot_spirc_current_track_artist(spirc: *const cspot_spirc_t)
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_album(spirc: *const cspot_spirc_t) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.album);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.album())
 }
 
 /// Returns the current track artwork URL, if available.
@@ -922,8 +1279,7 @@ pub extern "C" fn cspot_spirc_current_track_album(spirc: *const cspot_spirc_t) -
 pub extern "C" fn cspot_spirc_current_track_artwork_url(
     spirc: *const cspot_spirc_t,
 ) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.artwork_url);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.artwork_url())
 }
 
 /// Returns the current track title, if available.
@@ -931,8 +1287,97 @@ pub extern "C" fn cspot_spirc_current_track_artwork_url(
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_current_track_title(spirc: *const cspot_spirc_t) -> *mut c_char {
-    let value = snapshot_from_spirc(spirc).and_then(|snapshot| snapshot.track.title);
-    string_to_owned_ptr(value)
+    track_string_from_spirc(spirc, |track| track.title())
+}
+
+/// Returns the shared metadata record of the current track, or null if there is no
+/// spirc.
+///
+/// The record is not copied, and stays valid after the track changes. The returned
+/// handle must be released with `cspot_metadata_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_current_track_metadata(
+    spirc: *const cspot_spirc_t,
+) -> *mut cspot_metadata_t {
+    match status_from_spirc(spirc) {
+        Some(cell) => metadata_into_handle(cell.track()),
+        None => ptr::null_mut(),
+    }
+}
+
+/// Registers a callback that receives player events as they happen.
+///
+/// Events are pushed from the status task as soon as the player reports them, so no
+/// polling is required. Passing a null callback removes the current callback; an
+/// invocation already in progress may still complete after this returns.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_set_event_callback(
+    spirc: *const cspot_spirc_t,
+    callback: cspot_event_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    if spirc.is_null() {
+        write_error(out_error, "spirc handle was null");
+        return false;
+    }
+    // Safety: spirc must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(spirc as *const SpircHandle) };
+    handle.events.set_callback(callback, user_data);
+    true
+}
+
+/// Copies queued player events into `buf`, oldest first, and returns how many were written.
+///
+/// Events are buffered only after the first call to this function or to
+/// `cspot_spirc_event_fd`; earlier events reach the registered callback, if any, and are
+/// not queued. Each spirc then buffers up to 512 events that have not been drained yet,
+/// independently of any registered callback. When the buffer is full, new events are
+/// dropped and counted by `cspot_spirc_dropped_event_count`. Intended for hosts that poll
+/// once per frame; only one thread should drain a given spirc at a time.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_drain_events(
+    spirc: *const cspot_spirc_t,
+    buf: *mut cspot_event_t,
+    cap: usize,
+) -> usize {
+    if spirc.is_null() || buf.is_null() || cap == 0 {
+        return 0;
+    }
+    // Safety: spirc must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(spirc as *const SpircHandle) };
+    // Safety: the caller guarantees `buf` holds at least `cap` events.
+    unsafe { handle.events.drain(buf, cap) }
+}
+
+/// Returns a descriptor that becomes readable when player events are waiting to be drained.
+///
+/// Register it for read readiness with poll/epoll/kqueue and call
+/// `cspot_spirc_drain_events` when it fires; the descriptor is reset by the drain and
+/// stays readable while events remain. The descriptor is owned by the spirc handle and
+/// must not be read or closed by the caller. Calling this starts event buffering, as
+/// described on `cspot_spirc_drain_events`. Returns -1 if unavailable, including on
+/// platforms without file descriptors.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_event_fd(spirc: *const cspot_spirc_t) -> c_int {
+    if spirc.is_null() {
+        return -1;
+    }
+    // Safety: spirc must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(spirc as *const SpircHandle) };
+    handle.events.ready_fd()
+}
+
+/// Returns how many player events were dropped because the drain buffer was full.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_dropped_event_count(spirc: *const cspot_spirc_t) -> u64 {
+    if spirc.is_null() {
+        return 0;
+    }
+    // Safety: spirc must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(spirc as *const SpircHandle) };
+    handle.events.dropped_count()
 }
 
 /// Requests a clean Connect shutdown.
@@ -966,7 +1411,7 @@ pub extern "C" fn cspot_spirc_task_run(
     };
 
     let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime().block_on(task);
+        runtime().block_on(monitored(TaskKind::Spirc, task));
     }));
     match result {
         Ok(()) => true,
@@ -977,6 +1422,43 @@ pub extern "C" fn cspot_spirc_task_run(
     }
 }
 
+/// Runs the Spirc task on the cspot runtime without blocking.
+///
+/// Returns an operation handle that completes when the task finishes; check it with
+/// `cspot_async_op_finish`. Cancelling the operation stops the task. The task handle
+/// is spent afterwards but must still be released with `cspot_spirc_task_free`; the
+/// operation handle must be released with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_spirc_task_run_async(
+    task: *mut cspot_spirc_task_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    if task.is_null() {
+        write_error(out_error, "spirc task handle was null");
+        return ptr::null_mut();
+    }
+    // Safety: task must be a valid handle allocated by cspot.
+    let handle = unsafe { &mut *(task as *mut SpircTaskHandle) };
+    let task = match handle.task.take() {
+        Some(value) => value,
+        None => {
+            write_error(out_error, "spirc task already completed");
+            return ptr::null_mut();
+        }
+    };
+    spawn_async_op(
+        async move {
+            monitored(TaskKind::Spirc, task).await;
+            Ok(())
+        },
+        callback,
+        user_data,
+    )
+}
+
 /// Frees a spirc task handle.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_task_free(task: *mut cspot_spirc_task_t) {
@@ -990,6 +1472,12 @@ pub extern "C" fn cspot_spirc_task_free(task: *mut cspot_spirc_task_t) {
 }
 
 /// Frees a spirc handle.
+///
+/// Waits for an event callback that is currently running to return, so `user_data`
+/// may be released afterwards. Safe to call from any thread, including cspot runtime
+/// threads, but not from inside the spirc's own event callback: that call cannot wait
+/// for the callback, logs an error, and leaves `user_data` in use until the callback
+/// returns.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_spirc_free(spirc: *mut cspot_spirc_t) {
     if spirc.is_null() {
@@ -997,5 +1485,133 @@ pub extern "C" fn cspot_spirc_free(spirc: *mut cspot_spirc_t) {
     }
     // Safety: spirc must be a valid handle allocated by cspot.
     let handle = unsafe { Box::from_raw(spirc as *mut SpircHandle) };
+    if !handle.events.close() {
+        log::error!("cspot_spirc_free was called from inside an event callback of the same spirc");
+    }
     handle.status_task.abort();
 }
+
+/// Spirc status publication without a spirc, for the benchmarks in `benches/`.
+#[cfg(feature = "bench")]
+pub(crate) mod bench {
+    use std::hint::black_box;
+    use std::sync::Mutex;
+
+    use super::*;
+    use crate::error::cspot_string_free;
+
+    type TrackField = for<'a> fn(&'a TrackMetadata) -> Option<&'a str>;
+
+    const TRACK_FIELDS: [TrackField; 6] = [
+        TrackMetadata::spotify_id,
+        TrackMetadata::uri,
+        TrackMetadata::artist,
+        TrackMetadata::album,
+        TrackMetadata::artwork_url,
+        TrackMetadata::title,
+    ];
+
+    /// Published status of a spirc playing a track with every string field set.
+    pub struct Status {
+        cell: SpircStatusCell,
+        /// The same status behind a mutex, read the way the getters did before
+        /// `cspot_spirc_get_status`: one lock and one deep copy per getter.
+        legacy: Mutex<SpircRuntimeStatus>,
+    }
+
+    impl Default for Status {
+        fn default() -> Self {
+            let mut status = SpircRuntimeStatus {
+                connected: true,
+                volume: u16::MAX / 2,
+                track: Arc::new(TrackMetadata::sample()),
+                ..SpircRuntimeStatus::default()
+            };
+            status.set_playback_state(PlaybackState::Playing);
+            status.set_position(42_000, true);
+            let cell = SpircStatusCell::default();
+            cell.publish(&status);
+            Self {
+                cell,
+                legacy: Mutex::new(status),
+            }
+        }
+    }
+
+    /// The status task's own copy of the status, for the thread publishing updates.
+    pub struct StatusWriter {
+        status: SpircRuntimeStatus,
+    }
+
+    impl Status {
+        pub fn writer(&self) -> StatusWriter {
+            let status = self.legacy.lock().unwrap_or_else(|err| err.into_inner());
+            StatusWriter {
+                status: status.clone(),
+            }
+        }
+
+        /// Publishes a position update the way the status task does for every
+        /// `PositionChanged` event.
+        pub fn publish_position(&self, writer: &mut StatusWriter, position_ms: u32) {
+            writer.status.set_position(position_ms, true);
+            self.cell.publish(&writer.status);
+        }
+
+        /// Applies a position update under the mutex, as the status task did before
+        /// publication became lock-free.
+        pub fn legacy_publish_position(&self, position_ms: u32) {
+            let mut status = self.legacy.lock().unwrap_or_else(|err| err.into_inner());
+            status.set_position(position_ms, true);
+        }
+
+        /// Reads every field through `cspot_spirc_get_status`.
+        pub fn get_status(&self, status: &mut cspot_spirc_status_t) {
+            fill_status(&self.cell, status);
+        }
+
+        /// Reads every field through the 14 per-field getters, freeing the strings they
+        /// return.
+        pub fn get_fields(&self) {
+            let cell = &self.cell;
+            black_box(cell.connected.load(Ordering::Relaxed));
+            black_box(cspot_playback_state_t::from(cell.anchor().playback_state));
+            black_box(cell.anchor().current_position_ms(cell.track().duration_ms));
+            black_box(cell.track().duration_ms);
+            black_box(cell.volume.load(Ordering::Relaxed));
+            black_box(cell.shuffle_enabled.load(Ordering::Relaxed));
+            black_box(cell.repeat_context_enabled.load(Ordering::Relaxed));
+            black_box(cell.repeat_track_enabled.load(Ordering::Relaxed));
+            for field in TRACK_FIELDS {
+                cspot_string_free(black_box(track_string(cell, field)));
+            }
+        }
+
+        /// Reads every field through the 14 getters as they were implemented on top of
+        /// `Mutex<SpircRuntimeStatus>`.
+        pub fn legacy_get_fields(&self) {
+            let snapshot = || {
+                let status = self.legacy.lock().unwrap_or_else(|err| err.into_inner());
+                (status.clone(), TrackMetadata::clone(&status.track))
+            };
+            black_box(snapshot().0.connected);
+            black_box(cspot_playback_state_t::from(
+                snapshot().0.anchor.playback_state,
+            ));
+            let (status, track) = snapshot();
+            black_box(status.anchor.current_position_ms(track.duration_ms));
+            black_box(snapshot().1.duration_ms);
+            black_box(snapshot().0.volume);
+            black_box(snapshot().0.shuffle_enabled);
+            black_box(snapshot().0.repeat_context_enabled);
+            black_box(snapshot().0.repeat_track_enabled);
+            for field in TRACK_FIELDS {
+                let track = snapshot().1;
+                let value = field(&track).map_or(ptr::null_mut(), |value| {
+                    cstring_from_str_lossy(value).into_raw()
+                });
+                cspot_string_free(black_box(value));
+            }
+        }
+    }
+}
@@ -0,0 +1,206 @@
+//! PCM sample conversion for cspot's own sinks.
+//!
+//! librespot's `Converter` allocates a new buffer for every packet and calls the
+//! ditherer through a trait object for every sample, which keeps the compiler from
+//! vectorizing it. The kernels here convert into a reused buffer in fixed-size chunks:
+//! dither noise for a chunk is generated first, then a branch-free loop scales, rounds,
+//! clamps and casts the whole chunk, which compiles to SIMD on every target.
+
+use librespot::playback::config::AudioFormat;
+use librespot::playback::convert::Converter;
+use librespot::playback::dither::DithererBuilder;
+
+/// Samples processed per chunk.
+const CHUNK: usize = 64;
+
+/// Adding and subtracting 1.5 * 2^52 rounds to the nearest integer using plain
+/// arithmetic, which vectorizes where `f64::round` becomes a libm call. Ties round to
+/// even instead of away from zero; dither makes the difference inaudible.
+const ROUND_MAGIC: f64 = 6_755_399_441_055_744.0;
+
+const S16_FACTOR: f64 = 32_768.0;
+const S24_FACTOR: f64 = 8_388_608.0;
+const S32_FACTOR: f64 = 2_147_483_648.0;
+
+enum Dither {
+    None,
+    /// Triangular (TPDF) noise of +/-1 LSB, the same shape as librespot's "tpdf".
+    Triangular {
+        state: u64,
+    },
+    /// Ditherers without a vectorized kernel use librespot's converter.
+    Fallback(Converter),
+}
+
+/// Converts interleaved F64 samples into the byte layout of an `AudioFormat`.
+pub(crate) struct PcmConverter {
+    dither: Dither,
+    buffer: Vec<u64>,
+}
+
+impl PcmConverter {
+    /// Creates a converter that applies the same dither as `ditherer` would in librespot.
+    pub(crate) fn new(ditherer: Option<DithererBuilder>) -> Self {
+        let dither = match ditherer {
+            None => Dither::None,
+            Some(builder) if builder().name() == "tpdf" => Dither::Triangular {
+                state: 0x9e37_79b9_7f4a_7c15,
+            },
+            Some(builder) => Dither::Fallback(Converter::new(Some(builder))),
+        };
+        Self {
+            dither,
+            buffer: Vec::new(),
+        }
+    }
+
+    /// Converts `samples` to `format` and passes the resulting bytes to `write`.
+    ///
+    /// F64 is passed through in place. Other formats are converted into a buffer that
+    /// is reused across calls, so steady-state conversion does not allocate.
+    pub(crate) fn convert<R>(
+        &mut self,
+        format: AudioFormat,
+        samples: &[f64],
+        write: impl FnOnce(&[u8]) -> R,
+    ) -> R {
+        let Self { dither, buffer } = self;
+        if let Dither::Fallback(converter) = dither {
+            return match format {
+                AudioFormat::F64 => write(as_bytes(samples)),
+                AudioFormat::F32 => write(as_bytes(&converter.f64_to_f32(samples))),
+                AudioFormat::S32 => write(as_bytes(&converter.f64_to_s32(samples))),
+                AudioFormat::S24 => write(as_bytes(&converter.f64_to_s24(samples))),
+                AudioFormat::S24_3 => write(as_bytes(&converter.f64_to_s24_3(samples))),
+                AudioFormat::S16 => write(as_bytes(&converter.f64_to_s16(samples))),
+            };
+        }
+
+        let len = samples.len();
+        match format {
+            AudioFormat::F64 => write(as_bytes(samples)),
+            AudioFormat::F32 => {
+                let out = output::<f32>(buffer, len);
+                for (dst, src) in out.iter_mut().zip(samples) {
+                    *dst = *src as f32;
+                }
+                write(as_bytes(out))
+            }
+            AudioFormat::S32 => {
+                let out = output::<i32>(buffer, len);
+                quantize_into(dither, samples, out, S32_FACTOR, |value| value);
+                write(as_bytes(out))
+            }
+            AudioFormat::S24 => {
+                let out = output::<i32>(buffer, len);
+                quantize_into(dither, samples, out, S24_FACTOR, |value| value);
+                write(as_bytes(out))
+            }
+            AudioFormat::S24_3 => {
+                let out = output::<[u8; 3]>(buffer, len);
+                quantize_into(dither, samples, out, S24_FACTOR, pack_i24);
+                write(as_bytes(out))
+            }
+            AudioFormat::S16 => {
+                let out = output::<i16>(buffer, len);
+                quantize_into(dither, samples, out, S16_FACTOR, |value| value as i16);
+                write(as_bytes(out))
+            }
+        }
+    }
+}
+
+/// Scales, dithers, rounds and clamps `src` into `dst` chunk by chunk.
+///
+/// Values are clamped to the signed range of `factor`, which keeps the padding byte of
+/// S24 zero and matches the saturating casts librespot uses for S16 and S32.
+#[inline(always)]
+fn quantize_into<T>(
+    dither: &mut Dither,
+    src: &[f64],
+    dst: &mut [T],
+    factor: f64,
+    store: impl Fn(i32) -> T,
+) {
+    let (min, max) = (-factor, factor - 1.0);
+    let mut noise = [0.0f64; CHUNK];
+    for (src, dst) in src.chunks(CHUNK).zip(dst.chunks_mut(CHUNK)) {
+        let noise = &mut noise[..src.len()];
+        fill_noise(dither, noise);
+        for ((dst, sample), noise) in dst.iter_mut().zip(src).zip(noise.iter()) {
+            let scaled = sample * factor + noise;
+            let rounded = (scaled + ROUND_MAGIC) - ROUND_MAGIC;
+            *dst = store(rounded.max(min).min(max) as i32);
+        }
+    }
+}
+
+/// Packs a 24-bit value into 3 bytes, dropping the padding byte like librespot's `i24`.
+#[inline(always)]
+fn pack_i24(value: i32) -> [u8; 3] {
+    let [a, b, c, d] = value.to_ne_bytes();
+    if cfg!(target_endian = "little") {
+        [a, b, c]
+    } else {
+        [b, c, d]
+    }
+}
+
+/// Grows `buffer` to hold `len` values of `T` and returns them.
+fn output<T: Copy>(buffer: &mut Vec<u64>, len: usize) -> &mut [T] {
+    let words = (len * size_of::<T>()).div_ceil(size_of::<u64>());
+    if buffer.len() < words {
+        buffer.resize(words, 0);
+    }
+    // Safety: the buffer is 8-byte aligned, large enough for `len` values, and every `T`
+    // used here is plain data valid for any bit pattern.
+    unsafe { std::slice::from_raw_parts_mut(buffer.as_mut_ptr() as *mut T, len) }
+}
+
+/// Fills `noise` with dither noise in LSBs, or zeros when dither is off.
+fn fill_noise(dither: &mut Dither, noise: &mut [f64]) {
+    match dither {
+        Dither::Triangular { state } => {
+            for value in noise {
+                *value = uniform(state) + uniform(state);
+            }
+        }
+        Dither::None | Dither::Fallback(_) => noise.fill(0.0),
+    }
+}
+
+/// Returns a uniform value in [-0.5, 0.5) from a xorshift64* generator.
+fn uniform(state: &mut u64) -> f64 {
+    let mut x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    let bits = x.wrapping_mul(0x2545_f491_4f6c_dd1d) >> 11;
+    bits as f64 * (1.0 / (1u64 << 53) as f64) - 0.5
+}
+
+pub(crate) fn as_bytes<T>(samples: &[T]) -> &[u8] {
+    // Safety: every sample type produced here is plain data without padding.
+    unsafe { std::slice::from_raw_parts(samples.as_ptr() as *const u8, size_of_val(samples)) }
+}
+
+/// `PcmConverter` for the benchmarks in `benches/`.
+#[cfg(feature = "bench")]
+pub(crate) mod bench {
+    use super::*;
+
+    pub struct Converter(PcmConverter);
+
+    impl Converter {
+        pub fn new(ditherer: Option<DithererBuilder>) -> Self {
+            Self(PcmConverter::new(ditherer))
+        }
+
+        /// Converts `samples` to `format` and returns the number of bytes produced.
+        pub fn convert(&mut self, format: AudioFormat, samples: &[f64]) -> usize {
+            self.0
+                .convert(format, samples, |bytes| std::hint::black_box(bytes).len())
+        }
+    }
+}
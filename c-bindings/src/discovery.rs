@@ -1,20 +1,30 @@
 use std::ffi::CString;
-use std::os::raw::c_char;
+use std::os::raw::{c_char, c_int, c_void};
 use std::panic::AssertUnwindSafe;
 use std::ptr;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, Ordering};
 
 use data_encoding::HEXLOWER;
 use futures_util::StreamExt;
+use futures_util::future::{self, Either};
 use once_cell::sync::Lazy;
 use sha1::{Digest, Sha1};
+use tokio::sync::mpsc::error::TryRecvError;
+use tokio::sync::{Mutex as AsyncMutex, mpsc, oneshot};
+use tokio::task::JoinHandle;
 
-use librespot::core::SessionConfig;
+use librespot::core::{Error as LibrespotError, SessionConfig};
 use librespot::discovery::{Credentials, DeviceType, Discovery};
 use librespot::protocol::authentication::AuthenticationType;
 
+use crate::async_op::{cspot_async_callback_t, cspot_async_op_t, spawn_async_op, take_async_value};
 use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
 use crate::ffi::read_cstr;
-use crate::runtime::runtime;
+use crate::notify::Notifier;
+use crate::runtime::{runtime, wake_host};
+use crate::runtime_stats::{TaskKind, monitored};
+use crate::trace;
 
 /// Opaque discovery handle for C callers.
 #[allow(non_camel_case_types)]
@@ -110,11 +120,148 @@ pub enum cspot_discovery_next_result_t {
     CSPOT_DISCOVERY_NEXT_CREDENTIALS = 0,
     CSPOT_DISCOVERY_NEXT_END = 1,
     CSPOT_DISCOVERY_NEXT_ERROR = 2,
+    CSPOT_DISCOVERY_NEXT_PENDING = 3,
+}
+
+/// Discovery state shared between a handle and operations waiting on it.
+///
+/// The discovery stream is driven by a pump task on the cspot runtime, which forwards
+/// credentials into a channel and signals `ready`. Callers only consume the channel,
+/// so they can block on it, poll it, or wait for it asynchronously.
+struct DiscoveryShared {
+    credentials: AsyncMutex<mpsc::UnboundedReceiver<Credentials>>,
+    ready: Notifier,
+    running: AtomicBool,
+}
+
+impl DiscoveryShared {
+    /// Records a channel result, keeping `ready` readable while credentials remain or
+    /// once the stream has ended.
+    fn settle(
+        &self,
+        receiver: &mpsc::UnboundedReceiver<Credentials>,
+        credentials: Option<Credentials>,
+    ) -> Option<CredentialsHandle> {
+        match credentials {
+            Some(credentials) => {
+                if !receiver.is_empty() {
+                    self.ready.notify();
+                }
+                Some(CredentialsHandle::new(credentials))
+            }
+            None => {
+                self.running.store(false, Ordering::Release);
+                self.ready.notify();
+                None
+            }
+        }
+    }
+
+    async fn next(&self) -> Option<CredentialsHandle> {
+        let mut receiver = self.credentials.lock().await;
+        self.ready.clear();
+        let credentials = receiver.recv().await;
+        self.settle(&receiver, credentials)
+    }
 }
 
 struct DiscoveryHandle {
-    discovery: Discovery,
-    running: bool,
+    shared: Arc<DiscoveryShared>,
+    shutdown: Option<oneshot::Sender<()>>,
+    pump: JoinHandle<()>,
+}
+
+/// Result of an asynchronous `cspot_discovery_next_async` call.
+struct DiscoveryNext(Option<CredentialsHandle>);
+
+/// Forwards discovered credentials to the handle until the stream ends or shutdown is
+/// requested, then stops the discovery server.
+async fn pump_discovery(
+    mut discovery: Discovery,
+    credentials: mpsc::UnboundedSender<Credentials>,
+    mut shutdown: oneshot::Receiver<()>,
+    shared: Arc<DiscoveryShared>,
+) {
+    loop {
+        match future::select(discovery.next(), &mut shutdown).await {
+            Either::Left((Some(item), _)) => {
+                trace::instant("startup", "discovery.credentials");
+                if credentials.send(item).is_err() {
+                    break;
+                }
+                shared.ready.notify();
+                wake_host();
+            }
+            Either::Left((None, _)) | Either::Right(_) => break,
+        }
+    }
+    drop(credentials);
+    shared.ready.notify();
+    if let Err(err) = discovery.shutdown().await {
+        log::warn!("discovery shutdown failed: {err}");
+    }
+}
+
+async fn launch_discovery(
+    device_id: String,
+    client_id: String,
+    name: String,
+    device_type: DeviceType,
+) -> Result<DiscoveryHandle, LibrespotError> {
+    let _span = trace::span("startup", "discovery.launch");
+    let discovery = Discovery::builder(device_id, client_id)
+        .name(name)
+        .device_type(device_type)
+        .launch()?;
+    let (credentials_tx, credentials) = mpsc::unbounded_channel();
+    let (shutdown_tx, shutdown) = oneshot::channel();
+    let shared = Arc::new(DiscoveryShared {
+        credentials: AsyncMutex::new(credentials),
+        ready: Notifier::new(),
+        running: AtomicBool::new(true),
+    });
+    let pump = tokio::spawn(monitored(
+        TaskKind::Discovery,
+        pump_discovery(discovery, credentials_tx, shutdown, Arc::clone(&shared)),
+    ));
+    Ok(DiscoveryHandle {
+        shared,
+        shutdown: Some(shutdown_tx),
+        pump,
+    })
+}
+
+/// Hands a credential result to the caller.
+fn write_next_result(
+    credentials: Option<CredentialsHandle>,
+    out_credentials: *mut *mut cspot_credentials_t,
+) -> cspot_discovery_next_result_t {
+    match credentials {
+        Some(handle) => {
+            // Safety: out_credentials is non-null and points to writable memory.
+            unsafe {
+                *out_credentials = Box::into_raw(Box::new(handle)) as *mut cspot_credentials_t;
+            }
+            cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_CREDENTIALS
+        }
+        None => cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_END,
+    }
+}
+
+/// Validates and resets an `out_credentials` argument.
+fn reset_out_credentials(
+    out_credentials: *mut *mut cspot_credentials_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    if out_credentials.is_null() {
+        write_error(out_error, "out_credentials was null");
+        return false;
+    }
+    // Safety: out_credentials is non-null and points to writable memory.
+    unsafe {
+        *out_credentials = ptr::null_mut();
+    }
+    true
 }
 
 struct CredentialsHandle {
@@ -196,19 +343,16 @@ pub extern "C" fn cspot_discovery_create(
     };
 
     let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime().block_on(async {
-            Discovery::builder(device_id, client_id)
-                .name(name)
-                .device_type(device_type.into())
-                .launch()
-        })
+        runtime().block_on(launch_discovery(
+            device_id,
+            client_id,
+            name,
+            device_type.into(),
+        ))
     }));
 
     match result {
-        Ok(Ok(discovery)) => Box::into_raw(Box::new(DiscoveryHandle {
-            discovery,
-            running: true,
-        })) as *mut cspot_discovery_t,
+        Ok(Ok(handle)) => Box::into_raw(Box::new(handle)) as *mut cspot_discovery_t,
         Ok(Err(err)) => {
             write_error(out_error, err.to_string());
             ptr::null_mut()
@@ -220,6 +364,62 @@ pub extern "C" fn cspot_discovery_create(
     }
 }
 
+/// Starts a discovery service without blocking.
+///
+/// Returns an operation handle that completes once the discovery server is running;
+/// claim the discovery handle with `cspot_async_op_take_discovery`. The operation
+/// handle must be released with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_discovery_create_async(
+    device_id: *const c_char,
+    client_id: *const c_char,
+    name: *const c_char,
+    device_type: cspot_device_type_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let device_id = match read_cstr(device_id, "device_id", out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+    let client_id = match read_cstr(client_id, "client_id", out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+    let name = match read_cstr(name, "name", out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+    let device_type = DeviceType::from(device_type);
+
+    spawn_async_op(
+        async move {
+            launch_discovery(device_id, client_id, name, device_type)
+                .await
+                .map_err(|err| err.to_string())
+        },
+        callback,
+        user_data,
+    )
+}
+
+/// Claims the discovery handle produced by `cspot_discovery_create_async`.
+///
+/// Returns null and writes an error if the operation has not completed successfully.
+/// The returned handle must be released with `cspot_discovery_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_discovery(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_discovery_t {
+    match take_async_value::<DiscoveryHandle>(op, out_error) {
+        Some(handle) => Box::into_raw(Box::new(handle)) as *mut cspot_discovery_t,
+        None => ptr::null_mut(),
+    }
+}
+
 /// Blocks until the next credential event or until discovery stops.
 ///
 /// Returns `CSPOT_DISCOVERY_NEXT_CREDENTIALS` when credentials are available,
@@ -232,38 +432,22 @@ pub extern "C" fn cspot_discovery_next(
     out_error: *mut *mut cspot_error_t,
 ) -> cspot_discovery_next_result_t {
     clear_error(out_error);
-    if out_credentials.is_null() {
-        write_error(out_error, "out_credentials was null");
+    if !reset_out_credentials(out_credentials, out_error) {
         return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR;
     }
-    // Safety: out_credentials is non-null and points to writable memory.
-    unsafe {
-        *out_credentials = ptr::null_mut();
-    }
     if discovery.is_null() {
         write_error(out_error, "discovery handle was null");
         return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR;
     }
 
     // Safety: discovery must be a valid handle allocated by cspot.
-    let handle = unsafe { &mut *(discovery as *mut DiscoveryHandle) };
+    let handle = unsafe { &*(discovery as *const DiscoveryHandle) };
     let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime().block_on(async { handle.discovery.next().await })
+        runtime().block_on(handle.shared.next())
     }));
 
     match result {
-        Ok(Some(credentials)) => {
-            let handle = CredentialsHandle::new(credentials);
-            // Safety: out_credentials is non-null and points to writable memory.
-            unsafe {
-                *out_credentials = Box::into_raw(Box::new(handle)) as *mut cspot_credentials_t;
-            }
-            cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_CREDENTIALS
-        }
-        Ok(None) => {
-            handle.running = false;
-            cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_END
-        }
+        Ok(credentials) => write_next_result(credentials, out_credentials),
         Err(_) => {
             write_error(out_error, "panic while waiting for discovery credentials");
             cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR
@@ -271,6 +455,110 @@ pub extern "C" fn cspot_discovery_next(
     }
 }
 
+/// Returns the next credential event without blocking.
+///
+/// Behaves like `cspot_discovery_next`, but returns `CSPOT_DISCOVERY_NEXT_PENDING`
+/// immediately when no credentials are waiting or another call is already waiting for
+/// them. Pair it with `cspot_discovery_fd` to wait for credentials from an existing
+/// poll loop.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_discovery_try_next(
+    discovery: *mut cspot_discovery_t,
+    out_credentials: *mut *mut cspot_credentials_t,
+    out_error: *mut *mut cspot_error_t,
+) -> cspot_discovery_next_result_t {
+    clear_error(out_error);
+    if !reset_out_credentials(out_credentials, out_error) {
+        return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR;
+    }
+    if discovery.is_null() {
+        write_error(out_error, "discovery handle was null");
+        return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR;
+    }
+
+    // Safety: discovery must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(discovery as *const DiscoveryHandle) };
+    let shared = &handle.shared;
+    let Ok(mut receiver) = shared.credentials.try_lock() else {
+        return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_PENDING;
+    };
+    shared.ready.clear();
+    let credentials = match receiver.try_recv() {
+        Ok(credentials) => Some(credentials),
+        Err(TryRecvError::Disconnected) => None,
+        Err(TryRecvError::Empty) => {
+            return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_PENDING;
+        }
+    };
+    let credentials = shared.settle(&receiver, credentials);
+    write_next_result(credentials, out_credentials)
+}
+
+/// Waits for the next credential event without blocking the caller.
+///
+/// Returns an operation handle that completes with the next credential event; claim it
+/// with `cspot_async_op_take_credentials`. While the operation is pending,
+/// `cspot_discovery_try_next` reports `CSPOT_DISCOVERY_NEXT_PENDING`. The operation
+/// handle must be released with `cspot_async_op_free`, and may outlive the discovery
+/// handle, in which case it completes with `CSPOT_DISCOVERY_NEXT_END`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_discovery_next_async(
+    discovery: *const cspot_discovery_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    if discovery.is_null() {
+        write_error(out_error, "discovery handle was null");
+        return ptr::null_mut();
+    }
+    // Safety: discovery must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(discovery as *const DiscoveryHandle) };
+    let shared = Arc::clone(&handle.shared);
+    spawn_async_op(
+        async move { Ok(DiscoveryNext(shared.next().await)) },
+        callback,
+        user_data,
+    )
+}
+
+/// Claims the credential event produced by `cspot_discovery_next_async`.
+///
+/// Returns `CSPOT_DISCOVERY_NEXT_ERROR` and writes an error if the operation has not
+/// completed successfully.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_credentials(
+    op: *const cspot_async_op_t,
+    out_credentials: *mut *mut cspot_credentials_t,
+    out_error: *mut *mut cspot_error_t,
+) -> cspot_discovery_next_result_t {
+    clear_error(out_error);
+    if !reset_out_credentials(out_credentials, out_error) {
+        return cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR;
+    }
+    match take_async_value::<DiscoveryNext>(op, out_error) {
+        Some(DiscoveryNext(credentials)) => write_next_result(credentials, out_credentials),
+        None => cspot_discovery_next_result_t::CSPOT_DISCOVERY_NEXT_ERROR,
+    }
+}
+
+/// Returns a descriptor that becomes readable when `cspot_discovery_try_next` has a
+/// result other than `CSPOT_DISCOVERY_NEXT_PENDING`.
+///
+/// The descriptor is owned by the discovery handle and must not be read or closed by
+/// the caller. Returns -1 if unavailable, including on platforms without file
+/// descriptors.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_discovery_fd(discovery: *const cspot_discovery_t) -> c_int {
+    if discovery.is_null() {
+        return -1;
+    }
+    // Safety: discovery must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(discovery as *const DiscoveryHandle) };
+    handle.shared.ready.fd()
+}
+
 /// Returns whether the discovery service is currently running.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_discovery_is_running(discovery: *const cspot_discovery_t) -> bool {
@@ -279,7 +567,7 @@ pub extern "C" fn cspot_discovery_is_running(discovery: *const cspot_discovery_t
     }
     // Safety: discovery must be a valid handle allocated by cspot.
     let handle = unsafe { &*(discovery as *const DiscoveryHandle) };
-    handle.running
+    handle.shared.running.load(Ordering::Acquire)
 }
 
 /// Shuts down discovery and releases associated resources.
@@ -289,10 +577,38 @@ pub extern "C" fn cspot_discovery_free(discovery: *mut cspot_discovery_t) {
         return;
     }
     // Safety: discovery must be a valid handle allocated by cspot.
-    let handle = unsafe { Box::from_raw(discovery as *mut DiscoveryHandle) };
-    let _ = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime().block_on(handle.discovery.shutdown())
-    }));
+    let mut handle = unsafe { Box::from_raw(discovery as *mut DiscoveryHandle) };
+    if let Some(shutdown) = handle.shutdown.take() {
+        let _ = shutdown.send(());
+    }
+    let _ = std::panic::catch_unwind(AssertUnwindSafe(|| runtime().block_on(handle.pump)));
+}
+
+/// Shuts down discovery without blocking.
+///
+/// The discovery handle is consumed immediately and must not be used afterwards. The
+/// returned operation completes once the discovery server has stopped; check it with
+/// `cspot_async_op_finish` and release it with `cspot_async_op_free`. Returns null if
+/// `discovery` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_discovery_free_async(
+    discovery: *mut cspot_discovery_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+) -> *mut cspot_async_op_t {
+    if discovery.is_null() {
+        return ptr::null_mut();
+    }
+    // Safety: discovery must be a valid handle allocated by cspot.
+    let mut handle = unsafe { Box::from_raw(discovery as *mut DiscoveryHandle) };
+    if let Some(shutdown) = handle.shutdown.take() {
+        let _ = shutdown.send(());
+    }
+    spawn_async_op(
+        async move { handle.pump.await.map_err(|err| err.to_string()) },
+        callback,
+        user_data,
+    )
 }
 
 /// Returns the username from credentials, or null if unavailable.
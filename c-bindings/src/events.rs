@@ -0,0 +1,195 @@
+//! Player event delivery for cspot's C bindings.
+
+use std::cell::Cell;
+use std::os::raw::{c_int, c_void};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+
+use arc_swap::ArcSwapOption;
+
+use crate::connect::cspot_playback_state_t;
+use crate::notify::Notifier;
+use crate::ring::SpscRing;
+use crate::runtime::wake_host;
+
+/// Number of undrained events each spirc buffers before dropping new ones.
+const EVENT_QUEUE_CAPACITY: usize = 512;
+
+thread_local! {
+    /// Address of the dispatcher whose callback this thread is running, or 0.
+    static IN_CALLBACK: Cell<usize> = const { Cell::new(0) };
+}
+
+/// Kind of change reported by a `cspot_event_t`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_event_kind_t {
+    CSPOT_EVENT_PLAYBACK_STATE_CHANGED = 0,
+    CSPOT_EVENT_TRACK_CHANGED = 1,
+    CSPOT_EVENT_SEEKED = 2,
+    CSPOT_EVENT_VOLUME_CHANGED = 3,
+    CSPOT_EVENT_SHUFFLE_CHANGED = 4,
+    CSPOT_EVENT_REPEAT_CHANGED = 5,
+    CSPOT_EVENT_SESSION_CONNECTED = 6,
+    CSPOT_EVENT_SESSION_DISCONNECTED = 7,
+}
+
+/// Player event delivered to C callers.
+///
+/// `kind` identifies what changed; the remaining fields carry the full playback
+/// status at the time of the event. Track strings are not included; call
+/// `cspot_spirc_get_status` after a `CSPOT_EVENT_TRACK_CHANGED` event to read them.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_event_t {
+    pub kind: cspot_event_kind_t,
+    pub playback_state: cspot_playback_state_t,
+    pub position_ms: u32,
+    pub duration_ms: u32,
+    pub volume: u16,
+    pub connected: bool,
+    pub shuffle_enabled: bool,
+    pub repeat_context_enabled: bool,
+    pub repeat_track_enabled: bool,
+}
+
+/// Callback invoked for each player event of a spirc instance.
+///
+/// The callback runs on a cspot runtime thread and should return quickly. The event
+/// pointer is only valid for the duration of the callback. The callback must not
+/// free the spirc it was registered on.
+#[allow(non_camel_case_types)]
+pub type cspot_event_callback_t =
+    Option<extern "C" fn(event: *const cspot_event_t, user_data: *mut c_void)>;
+
+struct EventCallback {
+    callback: extern "C" fn(event: *const cspot_event_t, user_data: *mut c_void),
+    user_data: usize,
+}
+
+/// Fan-out point for events produced by a spirc status task.
+///
+/// Every event goes to the registered callback, if any. Once the host has asked for
+/// the readiness descriptor or drained events for the first time, events are also
+/// queued for it, and the descriptor stays readable while the queue is non-empty;
+/// callback-only hosts never fill the queue. The status task is the only producer.
+pub(crate) struct EventDispatcher {
+    callback: ArcSwapOption<EventCallback>,
+    /// Held while the callback runs, so `close` can wait for it to return.
+    delivery: Mutex<()>,
+    queue: SpscRing<cspot_event_t>,
+    ready: Notifier,
+    /// Set by the first `drain` or `ready_fd` call; nothing is queued before that.
+    queueing: AtomicBool,
+    draining: AtomicBool,
+    dropped: AtomicU64,
+}
+
+impl Default for EventDispatcher {
+    fn default() -> Self {
+        Self {
+            callback: ArcSwapOption::empty(),
+            delivery: Mutex::new(()),
+            queue: SpscRing::with_capacity(EVENT_QUEUE_CAPACITY),
+            ready: Notifier::new(),
+            queueing: AtomicBool::new(false),
+            draining: AtomicBool::new(false),
+            dropped: AtomicU64::new(0),
+        }
+    }
+}
+
+impl EventDispatcher {
+    pub(crate) fn set_callback(&self, callback: cspot_event_callback_t, user_data: *mut c_void) {
+        let callback = callback.map(|callback| {
+            Arc::new(EventCallback {
+                callback,
+                user_data: user_data as usize,
+            })
+        });
+        self.callback.store(callback);
+    }
+
+    /// Delivers an event. Must only be called from the spirc status task.
+    pub(crate) fn dispatch(&self, event: &cspot_event_t) {
+        if self.queueing.load(Ordering::Acquire) {
+            // Safety: the status task is the queue's only producer.
+            if !unsafe { self.queue.push(*event) } {
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+            }
+            self.ready.notify();
+            wake_host();
+        }
+        if self.callback.load().is_none() {
+            return;
+        }
+        // The callback is loaded again under the delivery lock, so once `close` has
+        // taken the lock no callback it removed can start.
+        let _delivery = self
+            .delivery
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        if let Some(callback) = self.callback.load().as_ref() {
+            let outer = IN_CALLBACK.replace(self as *const Self as usize);
+            (callback.callback)(event, callback.user_data as *mut c_void);
+            IN_CALLBACK.set(outer);
+        }
+    }
+
+    /// Removes the callback and waits for a call already in progress to return,
+    /// without needing the runtime, so it may be called from any thread.
+    ///
+    /// Returns false without waiting when called from inside this dispatcher's own
+    /// callback, which cannot wait for itself.
+    pub(crate) fn close(&self) -> bool {
+        self.callback.store(None);
+        if IN_CALLBACK.get() == self as *const Self as usize {
+            return false;
+        }
+        drop(
+            self.delivery
+                .lock()
+                .unwrap_or_else(|poisoned| poisoned.into_inner()),
+        );
+        true
+    }
+
+    /// Copies up to `len` queued events into `out`, oldest first.
+    ///
+    /// Concurrent drains are not blocked; a call that overlaps another drain of the
+    /// same spirc returns 0.
+    ///
+    /// # Safety
+    ///
+    /// `out` must be valid for writes of `len` events.
+    pub(crate) unsafe fn drain(&self, out: *mut cspot_event_t, len: usize) -> usize {
+        self.queueing.store(true, Ordering::Release);
+        if self
+            .draining
+            .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            return 0;
+        }
+        self.ready.clear();
+        // Safety: the draining flag makes this the queue's only consumer, and the
+        // caller guarantees `out` is writable.
+        let count = unsafe { self.queue.pop_into(out, len) };
+        if !self.queue.is_empty() {
+            self.ready.notify();
+        }
+        self.draining.store(false, Ordering::Release);
+        count
+    }
+
+    pub(crate) fn ready_fd(&self) -> c_int {
+        self.queueing.store(true, Ordering::Release);
+        self.ready.fd()
+    }
+
+    pub(crate) fn dropped_count(&self) -> u64 {
+        self.dropped.load(Ordering::Relaxed)
+    }
+}
@@ -18,3 +18,33 @@ pub(crate) fn read_cstr(
     let cstr = unsafe { CStr::from_ptr(value) };
     Some(cstr.to_string_lossy().into_owned())
 }
+
+/// Reads a nullable C string, treating null as absent.
+pub(crate) fn read_optional_cstr(value: *const c_char) -> Option<String> {
+    if value.is_null() {
+        return None;
+    }
+    // Safety: caller guarantees a valid, NUL-terminated C string when non-null.
+    let cstr = unsafe { CStr::from_ptr(value) };
+    Some(cstr.to_string_lossy().into_owned())
+}
+
+/// Reads an array of C strings, such as a list of Spotify URIs.
+pub(crate) fn read_cstr_array(
+    values: *const *const c_char,
+    count: usize,
+    field: &'static str,
+    out_error: *mut *mut cspot_error_t,
+) -> Option<Vec<String>> {
+    if count > 0 && values.is_null() {
+        write_error(out_error, format!("{field}s was null"));
+        return None;
+    }
+    let mut strings = Vec::with_capacity(count);
+    for index in 0..count {
+        // Safety: values is valid for count entries.
+        let value = unsafe { *values.add(index) };
+        strings.push(read_cstr(value, field, out_error)?);
+    }
+    Some(strings)
+}
@@ -1,12 +1,31 @@
 //! C FFI entry points for cspot.
 
 mod android;
+mod artwork;
+mod async_op;
+mod cache;
 mod discovery;
 mod error;
+mod events;
 mod ffi;
 mod logging;
+mod metadata;
+mod metrics;
+mod metrics_server;
+mod notify;
+mod pcm;
 mod connect;
+mod convert;
 mod playback;
+mod prefetch;
+mod ring;
 mod runtime;
+mod runtime_stats;
 mod session;
+mod sink;
+mod trace;
 mod uri;
+
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub mod bench;
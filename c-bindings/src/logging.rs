@@ -1,15 +1,24 @@
 //! Logging configuration for cspot's C bindings.
 
-use std::ffi::CStr;
+use std::borrow::Cow;
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::ffi::{CStr, CString};
+use std::io::Write as _;
 use std::os::raw::{c_char, c_void};
 use std::ptr;
-use std::sync::atomic::{AtomicU8, Ordering};
-use std::sync::{Once, RwLock};
+use std::sync::atomic::{AtomicBool, AtomicU8, AtomicU64, Ordering};
+use std::sync::{Arc, Once, RwLock};
+use std::thread::{self, Thread};
+use std::time::{Duration, Instant};
 
+use arc_swap::ArcSwap;
 use log::{Level, LevelFilter, Log, Metadata, Record};
 use once_cell::sync::Lazy;
 
 use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
+use crate::ring::MpmcQueue;
+use crate::trace;
 
 const LOGGER_STATE_UNINIT: u8 = 0;
 const LOGGER_STATE_READY: u8 = 1;
@@ -18,6 +27,153 @@ const LOGGER_STATE_FAILED: u8 = 2;
 static LOGGER_STATE: AtomicU8 = AtomicU8::new(LOGGER_STATE_UNINIT);
 static LOGGER_INIT: Once = Once::new();
 static CSPOT_LOGGER: Lazy<CspotLogger> = Lazy::new(CspotLogger::new);
+static DROPPED_RECORDS: AtomicU64 = AtomicU64::new(0);
+
+/// Records queued for the logging thread unless configured otherwise.
+const DEFAULT_QUEUE_CAPACITY: usize = 1024;
+/// Longest a blocked producer or `flush` sleeps before rechecking the queue.
+const QUEUE_POLL_INTERVAL: Duration = Duration::from_micros(200);
+/// Upper bound on how long `flush` waits for the logging thread to drain the queue.
+const FLUSH_TIMEOUT: Duration = Duration::from_secs(1);
+/// How often pending rate limit summaries are checked for targets that went quiet.
+const SUMMARY_INTERVAL: Duration = Duration::from_secs(1);
+
+static SUMMARY_START: Once = Once::new();
+
+/// NUL-terminated copies of `'static` strings such as module paths and file names,
+/// keyed by address and length. Each is created once and lives for the process.
+static STATIC_CSTRS: Lazy<RwLock<HashMap<(usize, usize), &'static CStr>>> =
+    Lazy::new(|| RwLock::new(HashMap::new()));
+
+thread_local! {
+    static IS_LOG_THREAD: std::cell::Cell<bool> = const { std::cell::Cell::new(false) };
+    /// Per-thread view of `STATIC_CSTRS`, so lookups take no shared lock.
+    static STATIC_CSTR_CACHE: RefCell<HashMap<(usize, usize), &'static CStr>> =
+        RefCell::new(HashMap::new());
+    /// Scratch space for the strings of a synchronously delivered record.
+    static RECORD_BUFFER: RefCell<Vec<u8>> = RefCell::new(Vec::with_capacity(512));
+}
+
+/// Returns a NUL-terminated copy of a `'static` string, creating it on first use.
+fn static_cstr(value: &'static str) -> &'static CStr {
+    let key = (value.as_ptr() as usize, value.len());
+    let cached = STATIC_CSTR_CACHE
+        .try_with(|cache| cache.try_borrow().ok().and_then(|cache| cache.get(&key).copied()))
+        .ok()
+        .flatten();
+    if let Some(cstr) = cached {
+        return cstr;
+    }
+
+    let shared = STATIC_CSTRS
+        .read()
+        .unwrap_or_else(|err| err.into_inner())
+        .get(&key)
+        .copied();
+    let cstr = shared.unwrap_or_else(|| {
+        let mut shared = STATIC_CSTRS.write().unwrap_or_else(|err| err.into_inner());
+        *shared
+            .entry(key)
+            .or_insert_with(|| Box::leak(cstring_from_str_lossy(value).into_boxed_c_str()))
+    });
+    let _ = STATIC_CSTR_CACHE.try_with(|cache| {
+        if let Ok(mut cache) = cache.try_borrow_mut() {
+            cache.insert(key, cstr);
+        }
+    });
+    cstr
+}
+
+/// Returns the record's target as a static C string when it is the module path, which
+/// is the default target of the `log` macros.
+fn static_target(record: &Record) -> Option<&'static CStr> {
+    let module_path = record.module_path_static()?;
+    let target = record.target();
+    (module_path.as_ptr() == target.as_ptr() && module_path.len() == target.len())
+        .then(|| static_cstr(module_path))
+}
+
+/// Appends `value` to `buffer` as a NUL-terminated string and returns its offset.
+fn push_cstr(buffer: &mut Vec<u8>, value: &str) -> usize {
+    let offset = buffer.len();
+    buffer.extend(value.bytes().map(|byte| if byte == 0 { b' ' } else { byte }));
+    buffer.push(0);
+    offset
+}
+
+/// Appends the formatted message to `buffer` as a NUL-terminated string and returns its
+/// offset.
+fn push_message(buffer: &mut Vec<u8>, record: &Record) -> usize {
+    let offset = buffer.len();
+    if let Some(message) = record.args().as_str() {
+        return push_cstr(buffer, message);
+    }
+    let _ = buffer.write_fmt(*record.args());
+    for byte in &mut buffer[offset..] {
+        if *byte == 0 {
+            *byte = b' ';
+        }
+    }
+    buffer.push(0);
+    offset
+}
+
+/// Delivers a record to the callback without allocating in the steady state.
+///
+/// Strings are formatted into a reusable per-thread buffer, and static strings come
+/// from `static_cstr`. A record logged from inside the callback on the same thread
+/// finds the buffer in use and falls back to an owned copy.
+fn deliver_record(record: &Record, callback: cspot_log_callback_t, user_data: usize) {
+    let Some(callback) = callback else {
+        eprintln!("{} {}: {}", record.level(), record.target(), record.args());
+        return;
+    };
+    let delivered = RECORD_BUFFER
+        .try_with(|buffer| {
+            let Ok(mut buffer) = buffer.try_borrow_mut() else {
+                return false;
+            };
+            buffer.clear();
+            let target = static_target(record);
+            let target_offset = target.is_none().then(|| push_cstr(&mut buffer, record.target()));
+            let message_offset = push_message(&mut buffer, record);
+            let module_path = record.module_path_static().map(static_cstr);
+            let module_path_offset = match (module_path, record.module_path()) {
+                (None, Some(value)) => Some(push_cstr(&mut buffer, value)),
+                _ => None,
+            };
+            let file = record.file_static().map(static_cstr);
+            let file_offset = match (file, record.file()) {
+                (None, Some(value)) => Some(push_cstr(&mut buffer, value)),
+                _ => None,
+            };
+
+            let base = buffer.as_ptr() as *const c_char;
+            // Safety: every offset was returned by a push into this buffer, which is not
+            // modified again until the callback returns.
+            let at = |offset: usize| unsafe { base.add(offset) };
+            let c_record = cspot_log_record_t {
+                level: cspot_log_level_t::from(record.level()),
+                target: target.map_or_else(|| at(target_offset.unwrap_or(0)), CStr::as_ptr),
+                message: at(message_offset),
+                module_path: module_path
+                    .map(CStr::as_ptr)
+                    .or(module_path_offset.map(at))
+                    .unwrap_or(ptr::null()),
+                file: file
+                    .map(CStr::as_ptr)
+                    .or(file_offset.map(at))
+                    .unwrap_or(ptr::null()),
+                line: record.line().unwrap_or(0),
+            };
+            callback(&c_record, user_data as *mut c_void);
+            true
+        })
+        .unwrap_or(false);
+    if !delivered {
+        QueuedRecord::new(record).deliver(Some(callback), user_data);
+    }
+}
 
 /// Log level values for cspot logging.
 #[allow(non_camel_case_types)]
@@ -73,11 +229,38 @@ pub struct cspot_log_record_t {
 
 /// Callback invoked for each log record emitted by cspot.
 ///
-/// The callback may be invoked from any thread that emits a log record.
+/// With synchronous delivery the callback may be invoked from any thread that emits a
+/// log record. With asynchronous delivery it is only invoked from cspot's logging
+/// thread.
 #[allow(non_camel_case_types)]
 pub type cspot_log_callback_t =
     Option<extern "C" fn(record: *const cspot_log_record_t, user_data: *mut c_void)>;
 
+/// How log records reach the callback.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_log_delivery_t {
+    /// The callback runs on the thread that emitted the record.
+    CSPOT_LOG_DELIVERY_SYNC = 0,
+    /// Records are queued and delivered by a dedicated logging thread, so a slow
+    /// callback never delays the emitting thread.
+    CSPOT_LOG_DELIVERY_ASYNC = 1,
+}
+
+/// What asynchronous delivery does with a record when the queue is full.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_log_drop_policy_t {
+    /// Discard the oldest queued record to make room.
+    CSPOT_LOG_DROP_OLDEST = 0,
+    /// Discard the new record.
+    CSPOT_LOG_DROP_NEWEST = 1,
+    /// Wait until the logging thread frees space.
+    CSPOT_LOG_BLOCK = 2,
+}
+
 /// Configuration for initializing cspot logging.
 ///
 /// If `filter` is non-null, it is interpreted as an `RUST_LOG`-style filter string and
@@ -85,51 +268,346 @@ pub type cspot_log_callback_t =
 /// environment value is used. Otherwise `level` is applied to librespot/libmdns logs.
 /// If `callback` is null, logs are written to stderr. Otherwise they are delivered to the
 /// callback with `user_data` forwarded unchanged.
+///
+/// `delivery` selects whether the callback runs on the emitting thread or on a logging
+/// thread. Asynchronous delivery queues up to `queue_capacity` records (0 selects the
+/// default of 1024) and applies `drop_policy` when the queue is full; dropped records
+/// are counted by `cspot_log_dropped_count`.
+///
+/// `rate_limit` caps each target at that many records per second after a burst of
+/// `rate_burst` (0 selects `rate_limit`), and `sample_every` keeps one record in that
+/// many; 0 disables either. ERROR records are never limited. A directive in `filter`
+/// can override them for the targets it matches by appending options, as in
+/// `librespot_audio=debug;rate=20;burst=100;sample=10`; every matching target gets its
+/// own budget. When a target accepts records again after suppressing some, it first
+/// emits a WARN summary such as "suppressed 4312 records from
+/// librespot_audio::fetch". A target that goes quiet instead gets its summary within
+/// about a second of its budget refilling, delivered from a cspot logging thread.
+/// `cspot_log_flush` emits any pending summaries.
 #[repr(C)]
 pub struct cspot_log_config_t {
     pub level: cspot_log_level_t,
     pub filter: *const c_char,
     pub callback: cspot_log_callback_t,
     pub user_data: *mut c_void,
+    pub delivery: cspot_log_delivery_t,
+    pub queue_capacity: usize,
+    pub drop_policy: cspot_log_drop_policy_t,
+    pub rate_limit: u32,
+    pub rate_burst: u32,
+    pub sample_every: u32,
 }
 
 #[derive(Clone)]
 struct TargetFilter {
     target: String,
     level: LevelFilter,
+    limit: Option<RateLimit>,
+}
+
+/// Rate limit and sampling applied to the records of one filter rule.
+#[derive(Clone, Copy, Debug, Default, Eq, PartialEq)]
+struct RateLimit {
+    /// Records per second, or 0 for no limit.
+    rate: u32,
+    /// Records accepted back to back before `rate` applies, or 0 to use `rate`.
+    burst: u32,
+    /// Keep one record in this many, or 0 to keep every record.
+    sample: u32,
+}
+
+impl RateLimit {
+    fn is_unlimited(&self) -> bool {
+        self.rate == 0 && self.sample <= 1
+    }
+}
+
+/// Monotonic nanoseconds for rate limiting. A millisecond or so of resolution is enough
+/// for records-per-second limits, so the cheaper coarse clock is used where available.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn limiter_now_ns() -> u64 {
+    let mut now = libc::timespec {
+        tv_sec: 0,
+        tv_nsec: 0,
+    };
+    // Safety: `now` is a valid timespec for clock_gettime to fill.
+    unsafe { libc::clock_gettime(libc::CLOCK_MONOTONIC_COARSE, &mut now) };
+    (now.tv_sec as u64)
+        .saturating_mul(1_000_000_000)
+        .saturating_add(now.tv_nsec as u64)
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn limiter_now_ns() -> u64 {
+    static EPOCH: Lazy<Instant> = Lazy::new(Instant::now);
+    EPOCH.elapsed().as_nanos() as u64
+}
+
+/// Rate limiter state for one target, shared by every thread logging to it.
+///
+/// The token bucket is kept as a single theoretical arrival time (GCRA), so accepting
+/// or rejecting a record is one compare-and-swap.
+struct TargetLimiter {
+    /// Name used in suppression summaries.
+    name: String,
+    interval_ns: u64,
+    tolerance_ns: u64,
+    sample: u64,
+    next_ns: AtomicU64,
+    seen: AtomicU64,
+    suppressed: AtomicU64,
+}
+
+impl TargetLimiter {
+    fn new(name: String, limit: RateLimit) -> Self {
+        let interval_ns = match limit.rate {
+            0 => 0,
+            rate => 1_000_000_000 / u64::from(rate),
+        };
+        let burst = match limit.burst {
+            0 => limit.rate,
+            burst => burst,
+        };
+        Self {
+            name,
+            interval_ns,
+            tolerance_ns: interval_ns.saturating_mul(u64::from(burst.saturating_sub(1))),
+            sample: u64::from(limit.sample),
+            next_ns: AtomicU64::new(0),
+            seen: AtomicU64::new(0),
+            suppressed: AtomicU64::new(0),
+        }
+    }
+
+    /// Returns whether a record may pass. Records refused by the rate limit are counted
+    /// for the next summary; records skipped by sampling are not.
+    fn admit(&self) -> bool {
+        if self.sample > 1 && self.seen.fetch_add(1, Ordering::Relaxed) % self.sample != 0 {
+            return false;
+        }
+        if self.interval_ns == 0 {
+            return true;
+        }
+        let now = limiter_now_ns();
+        let mut next = self.next_ns.load(Ordering::Relaxed);
+        loop {
+            let start = next.max(now);
+            if start - now > self.tolerance_ns {
+                self.suppressed.fetch_add(1, Ordering::Relaxed);
+                return false;
+            }
+            match self.next_ns.compare_exchange_weak(
+                next,
+                start + self.interval_ns,
+                Ordering::Relaxed,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) => return true,
+                Err(current) => next = current,
+            }
+        }
+    }
+
+    /// Takes the number of records suppressed since the last summary.
+    fn take_suppressed(&self) -> u64 {
+        if self.suppressed.load(Ordering::Relaxed) == 0 {
+            return 0;
+        }
+        self.suppressed.swap(0, Ordering::Relaxed)
+    }
+
+    /// Like `take_suppressed`, but only once the bucket would accept a record at `now`.
+    fn take_refilled(&self, now: u64) -> u64 {
+        if self.next_ns.load(Ordering::Relaxed).saturating_sub(now) > self.tolerance_ns {
+            return 0;
+        }
+        self.take_suppressed()
+    }
+}
+
+/// Most targets one rule tracks separately; further targets share the rule's overflow
+/// limiter, so dynamically built targets cannot grow the map without bound.
+const MAX_LIMITED_TARGETS: usize = 1024;
+
+/// Rate limit of one filter rule, applied to each target it matches separately.
+struct RuleLimit {
+    limit: RateLimit,
+    targets: RwLock<HashMap<String, Arc<TargetLimiter>>>,
+    overflow: Arc<TargetLimiter>,
+}
+
+impl RuleLimit {
+    fn new(name: String, limit: RateLimit) -> Self {
+        Self {
+            limit,
+            targets: RwLock::new(HashMap::new()),
+            overflow: Arc::new(TargetLimiter::new(name, limit)),
+        }
+    }
+
+    /// Returns the limiter of `target`, creating it on first use.
+    fn limiter_for(&self, target: &str) -> Arc<TargetLimiter> {
+        if let Some(limiter) = self
+            .targets
+            .read()
+            .unwrap_or_else(|err| err.into_inner())
+            .get(target)
+        {
+            return Arc::clone(limiter);
+        }
+        let mut targets = self.targets.write().unwrap_or_else(|err| err.into_inner());
+        if targets.len() >= MAX_LIMITED_TARGETS && !targets.contains_key(target) {
+            return Arc::clone(&self.overflow);
+        }
+        Arc::clone(
+            targets
+                .entry(target.to_string())
+                .or_insert_with(|| Arc::new(TargetLimiter::new(target.to_string(), self.limit))),
+        )
+    }
+
+    /// Calls `f` with every limiter of the rule.
+    fn for_each(&self, mut f: impl FnMut(&TargetLimiter)) {
+        let targets = self.targets.read().unwrap_or_else(|err| err.into_inner());
+        targets.values().for_each(|limiter| f(limiter));
+        f(&self.overflow);
+    }
+}
+
+/// Outcome of running a record through the filter's rate limits.
+enum Admission {
+    Reject,
+    Accept,
+    /// Accept, after reporting `count` records of `target` suppressed before this one.
+    Resume { target: String, count: u64 },
+}
+
+/// Source of `LogFilter::generation`, so per-thread caches notice a new filter.
+static FILTER_GENERATION: AtomicU64 = AtomicU64::new(1);
+
+/// Slots in the per-thread target rule cache. A power of two.
+const LEVEL_CACHE_SLOTS: usize = 64;
+
+struct LevelCacheSlot {
+    address: usize,
+    target: String,
+    rule: usize,
+    limiter: Option<Arc<TargetLimiter>>,
+}
+
+impl LevelCacheSlot {
+    fn empty() -> Self {
+        Self {
+            address: 0,
+            target: String::new(),
+            rule: 0,
+            limiter: None,
+        }
+    }
+}
+
+/// Direct-mapped cache of the rule each target resolves to, and of the target's rate
+/// limiter, for one filter generation.
+///
+/// Slots are keyed by the target's address and confirmed by comparing its text, so a
+/// reused address can never return another target's rule.
+struct LevelCache {
+    generation: u64,
+    slots: Vec<LevelCacheSlot>,
+}
+
+thread_local! {
+    static LEVEL_CACHE: RefCell<LevelCache> = RefCell::new(LevelCache {
+        generation: 0,
+        slots: Vec::new(),
+    });
 }
 
-#[derive(Clone)]
 struct LogFilter {
     default: LevelFilter,
+    /// Ordered so the first matching prefix is the one that applies.
     directives: Vec<TargetFilter>,
+    /// One per directive, followed by the default rule's; empty if nothing is limited.
+    limiters: Vec<Option<RuleLimit>>,
+    generation: u64,
+    min_level: LevelFilter,
+    max_level: LevelFilter,
 }
 
 impl LogFilter {
-    fn default_for_level(level: LevelFilter) -> Self {
+    /// Builds a filter. `default_limit` applies to targets no directive matches.
+    fn new(
+        default: LevelFilter,
+        default_limit: Option<RateLimit>,
+        mut directives: Vec<TargetFilter>,
+    ) -> Self {
+        // The longest prefix wins, and among equal prefixes the last directive given.
+        directives.reverse();
+        directives.sort_by(|left, right| right.target.len().cmp(&left.target.len()));
+        let levels = || std::iter::once(default).chain(directives.iter().map(|d| d.level));
+        let min_level = levels().min().unwrap_or(default);
+        let max_level = levels().max().unwrap_or(default);
+
+        let rules = directives
+            .iter()
+            .map(|directive| (directive.target.clone(), directive.limit))
+            .chain(std::iter::once(("other targets".to_string(), default_limit)));
+        let mut limiters: Vec<_> = rules
+            .map(|(name, limit)| {
+                limit
+                    .filter(|limit| !limit.is_unlimited())
+                    .map(|limit| RuleLimit::new(name, limit))
+            })
+            .collect();
+        if limiters.iter().all(Option::is_none) {
+            limiters.clear();
+        }
+
         Self {
-            default: LevelFilter::Off,
-            directives: vec![
-                TargetFilter {
-                    target: "librespot".to_string(),
-                    level,
-                },
-            ],
+            default,
+            generation: FILTER_GENERATION.fetch_add(1, Ordering::Relaxed),
+            min_level,
+            max_level,
+            directives,
+            limiters,
         }
     }
 
-    fn parse(spec: &str) -> Result<Self, String> {
+    /// Builds the filter used without a spec. `limit` applies to every target.
+    fn default_for_level(level: LevelFilter, limit: Option<RateLimit>) -> Self {
+        Self::new(
+            LevelFilter::Off,
+            limit,
+            vec![TargetFilter {
+                target: "librespot".to_string(),
+                level,
+                limit,
+            }],
+        )
+    }
+
+    /// Parses an `RUST_LOG`-style spec. Each directive may append `;rate=N`, `;burst=N`
+    /// and `;sample=N` to limit the records of each target it matches; `limit` applies
+    /// to directives that do not.
+    fn parse(spec: &str, limit: Option<RateLimit>) -> Result<Self, String> {
         let mut default = LevelFilter::Off;
+        let mut default_limit = limit;
         let mut directives = Vec::new();
 
         for (index, raw) in spec.split(',').enumerate() {
-            let directive = raw.trim();
+            let mut options = raw.split(';');
+            let directive = options.next().unwrap_or_default().trim();
+            let directive_limit = parse_rate_limit(options)?;
             if directive.is_empty() {
+                if directive_limit.is_some() {
+                    return Err(format!("empty log directive at position {index}"));
+                }
                 continue;
             }
             let mut parts = directive.splitn(2, '=');
             let left = parts.next().unwrap_or_default().trim();
             let right = parts.next().map(str::trim);
+            let limit = directive_limit.or(limit);
 
             if left.is_empty() {
                 return Err(format!("empty log directive at position {index}"));
@@ -144,47 +622,351 @@ impl LogFilter {
                 directives.push(TargetFilter {
                     target: left.to_string(),
                     level,
+                    limit,
                 });
             } else if let Some(level) = parse_level(left) {
                 default = level;
+                default_limit = limit;
             } else {
                 directives.push(TargetFilter {
                     target: left.to_string(),
                     level: LevelFilter::Trace,
+                    limit,
                 });
             }
         }
 
-        Ok(Self { default, directives })
+        Ok(Self::new(default, default_limit, directives))
     }
 
     fn enabled(&self, metadata: &Metadata) -> bool {
-        let target = metadata.target();
-        let mut best_level = self.default;
-        let mut best_len = 0usize;
-
-        for directive in &self.directives {
-            if target.starts_with(&directive.target) {
-                let len = directive.target.len();
-                if len >= best_len {
-                    best_len = len;
-                    best_level = directive.level;
+        let record_level = metadata.level().to_level_filter();
+        if record_level > self.max_level {
+            return false;
+        }
+        if record_level <= self.min_level {
+            return true;
+        }
+        record_level <= self.rule_level(self.cached_rule_for(metadata.target()))
+    }
+
+    /// Applies the rate limit of `target` under the rule it falls under. ERROR records
+    /// always pass.
+    fn admit(&self, level: Level, target: &str) -> Admission {
+        if self.limiters.is_empty() || level == Level::Error {
+            return Admission::Accept;
+        }
+        self.with_cached_target(target, |_, limiter| {
+            let Some(limiter) = limiter else {
+                return Admission::Accept;
+            };
+            if !limiter.admit() {
+                return Admission::Reject;
+            }
+            match limiter.take_suppressed() {
+                0 => Admission::Accept,
+                count => Admission::Resume {
+                    target: limiter.name.clone(),
+                    count,
+                },
+            }
+        })
+    }
+
+    /// Takes the pending suppression counts of every target that has one.
+    fn take_suppressed(&self) -> Vec<(String, u64)> {
+        self.collect_suppressed(TargetLimiter::take_suppressed)
+    }
+
+    /// Takes the pending suppression counts of targets whose bucket has refilled, so
+    /// a target that went quiet is reported without waiting for its next record.
+    fn take_refilled(&self) -> Vec<(String, u64)> {
+        let now = limiter_now_ns();
+        self.collect_suppressed(|limiter| limiter.take_refilled(now))
+    }
+
+    fn collect_suppressed(&self, take: impl Fn(&TargetLimiter) -> u64) -> Vec<(String, u64)> {
+        let mut suppressed = Vec::new();
+        for rule in self.limiters.iter().flatten() {
+            rule.for_each(|limiter| match take(limiter) {
+                0 => {}
+                count => suppressed.push((limiter.name.clone(), count)),
+            });
+        }
+        suppressed
+    }
+
+    fn is_rate_limited(&self) -> bool {
+        !self.limiters.is_empty()
+    }
+
+    /// Returns the limiter for `target` under `rule`, if the rule is limited.
+    fn limiter_for(&self, rule: usize, target: &str) -> Option<Arc<TargetLimiter>> {
+        self.limiters
+            .get(rule)
+            .and_then(Option::as_ref)
+            .map(|rule| rule.limiter_for(target))
+    }
+
+    fn cached_rule_for(&self, target: &str) -> usize {
+        self.with_cached_target(target, |rule, _| rule)
+    }
+
+    /// Looks up `target` in the calling thread's rule cache, resolving it on a miss, and
+    /// calls `f` with its rule and limiter.
+    fn with_cached_target<T>(
+        &self,
+        target: &str,
+        f: impl FnOnce(usize, Option<&TargetLimiter>) -> T,
+    ) -> T {
+        let mut f = Some(f);
+        let cached = LEVEL_CACHE
+            .try_with(|cache| {
+                let mut cache = cache.try_borrow_mut().ok()?;
+                if cache.generation != self.generation {
+                    cache.generation = self.generation;
+                    cache.slots.clear();
+                    cache.slots.resize_with(LEVEL_CACHE_SLOTS, LevelCacheSlot::empty);
                 }
+                let address = target.as_ptr() as usize;
+                let index = ((address >> 3) ^ target.len()) & (LEVEL_CACHE_SLOTS - 1);
+                let slot = &mut cache.slots[index];
+                if slot.address != address || slot.target != target {
+                    slot.address = address;
+                    slot.target.clear();
+                    slot.target.push_str(target);
+                    slot.rule = self.rule_for(target);
+                    slot.limiter = self.limiter_for(slot.rule, target);
+                }
+                let f = f.take()?;
+                Some(f(slot.rule, slot.limiter.as_deref()))
+            })
+            .ok()
+            .flatten();
+        match (cached, f) {
+            (Some(value), _) => value,
+            (None, Some(f)) => {
+                let rule = self.rule_for(target);
+                f(rule, self.limiter_for(rule, target).as_deref())
             }
+            (None, None) => unreachable!("the callback only runs when the cache answers"),
         }
+    }
 
-        let record_level = metadata.level().to_level_filter();
-        record_level <= best_level
+    /// Returns the index of the directive that applies to `target`, or
+    /// `directives.len()` for the default rule.
+    fn rule_for(&self, target: &str) -> usize {
+        self.directives
+            .iter()
+            .position(|directive| target.starts_with(&directive.target))
+            .unwrap_or(self.directives.len())
+    }
+
+    fn rule_level(&self, rule: usize) -> LevelFilter {
+        self.directives
+            .get(rule)
+            .map_or(self.default, |directive| directive.level)
     }
 
     fn max_level(&self) -> LevelFilter {
-        let mut max_level = self.default;
-        for directive in &self.directives {
-            if directive.level > max_level {
-                max_level = directive.level;
+        self.max_level
+    }
+}
+
+/// Parses the `;key=value` options that may follow a filter directive.
+fn parse_rate_limit<'a>(
+    options: impl Iterator<Item = &'a str>,
+) -> Result<Option<RateLimit>, String> {
+    let mut limit = None::<RateLimit>;
+    for option in options {
+        let option = option.trim();
+        let (key, value) = option
+            .split_once('=')
+            .map(|(key, value)| (key.trim(), value.trim()))
+            .ok_or_else(|| format!("invalid log directive option `{option}`"))?;
+        let value = value
+            .parse::<u32>()
+            .ok()
+            .filter(|value| *value > 0)
+            .ok_or_else(|| format!("`{key}` must be a positive integer, got `{value}`"))?;
+        let limit = limit.get_or_insert_with(RateLimit::default);
+        match key {
+            "rate" => limit.rate = value,
+            "burst" => limit.burst = value,
+            "sample" => limit.sample = value,
+            _ => return Err(format!("unknown log directive option `{key}`")),
+        }
+    }
+    Ok(limit)
+}
+
+/// Log record copied out of a `Record` so it can be delivered later.
+///
+/// Static strings are borrowed from `static_cstr`, so usually only the message is
+/// allocated.
+struct QueuedRecord {
+    level: Level,
+    target: Cow<'static, CStr>,
+    message: CString,
+    module_path: Option<Cow<'static, CStr>>,
+    file: Option<Cow<'static, CStr>>,
+    line: u32,
+}
+
+fn owned_or_static(
+    value: Option<&str>,
+    static_value: Option<&'static str>,
+) -> Option<Cow<'static, CStr>> {
+    match static_value {
+        Some(value) => Some(Cow::Borrowed(static_cstr(value))),
+        None => value.map(|value| Cow::Owned(cstring_from_str_lossy(value))),
+    }
+}
+
+impl QueuedRecord {
+    fn new(record: &Record) -> Self {
+        let mut message = Vec::new();
+        push_message(&mut message, record);
+        message.pop();
+        Self {
+            level: record.level(),
+            target: match static_target(record) {
+                Some(target) => Cow::Borrowed(target),
+                None => Cow::Owned(cstring_from_str_lossy(record.target())),
+            },
+            // push_message replaced interior NUL bytes, so this cannot fail.
+            message: CString::new(message).unwrap_or_default(),
+            module_path: owned_or_static(record.module_path(), record.module_path_static()),
+            file: owned_or_static(record.file(), record.file_static()),
+            line: record.line().unwrap_or(0),
+        }
+    }
+
+    fn deliver(&self, callback: cspot_log_callback_t, user_data: usize) {
+        let Some(callback) = callback else {
+            eprintln!(
+                "{} {}: {}",
+                self.level,
+                self.target.to_string_lossy(),
+                self.message.to_string_lossy()
+            );
+            return;
+        };
+        let record = cspot_log_record_t {
+            level: cspot_log_level_t::from(self.level),
+            target: self.target.as_ptr(),
+            message: self.message.as_ptr(),
+            module_path: self
+                .module_path
+                .as_ref()
+                .map_or(ptr::null(), |value| value.as_ptr()),
+            file: self.file.as_ref().map_or(ptr::null(), |value| value.as_ptr()),
+            line: self.line,
+        };
+        callback(&record, user_data as *mut c_void);
+    }
+}
+
+/// Bounded queue drained by a dedicated logging thread.
+struct AsyncDelivery {
+    queue: MpmcQueue<QueuedRecord>,
+    drop_policy: cspot_log_drop_policy_t,
+    worker: Thread,
+    closed: AtomicBool,
+    /// Set while the logging thread is delivering a popped record.
+    busy: AtomicBool,
+}
+
+impl AsyncDelivery {
+    fn start(capacity: usize, drop_policy: cspot_log_drop_policy_t) -> Result<Arc<Self>, String> {
+        let (sender, receiver) = std::sync::mpsc::channel::<Arc<Self>>();
+        let handle = thread::Builder::new()
+            .name("cspot-log".to_string())
+            .spawn(move || {
+                IS_LOG_THREAD.with(|flag| flag.set(true));
+                if let Ok(delivery) = receiver.recv() {
+                    delivery.run();
+                }
+            })
+            .map_err(|err| format!("failed to start logging thread: {err}"))?;
+        let delivery = Arc::new(Self {
+            queue: MpmcQueue::with_capacity(capacity),
+            drop_policy,
+            worker: handle.thread().clone(),
+            closed: AtomicBool::new(false),
+            busy: AtomicBool::new(false),
+        });
+        sender
+            .send(Arc::clone(&delivery))
+            .map_err(|_| "logging thread exited early".to_string())?;
+        Ok(delivery)
+    }
+
+    fn run(&self) {
+        loop {
+            while let Some(record) = {
+                self.busy.store(true, Ordering::Release);
+                self.queue.pop()
+            } {
+                let (callback, user_data) =
+                    CSPOT_LOGGER.with_config(|config| (config.callback, config.user_data));
+                record.deliver(callback, user_data);
+            }
+            self.busy.store(false, Ordering::Release);
+            if self.closed.load(Ordering::Acquire) && self.queue.len() == 0 {
+                return;
+            }
+            thread::park();
+        }
+    }
+
+    fn enqueue(&self, record: QueuedRecord) {
+        let mut record = record;
+        loop {
+            match self.queue.push(record) {
+                Ok(()) => break,
+                Err(rejected) => match self.drop_policy {
+                    cspot_log_drop_policy_t::CSPOT_LOG_DROP_NEWEST => {
+                        DROPPED_RECORDS.fetch_add(1, Ordering::Relaxed);
+                        break;
+                    }
+                    cspot_log_drop_policy_t::CSPOT_LOG_DROP_OLDEST => {
+                        if self.queue.pop().is_some() {
+                            DROPPED_RECORDS.fetch_add(1, Ordering::Relaxed);
+                        }
+                        record = rejected;
+                    }
+                    cspot_log_drop_policy_t::CSPOT_LOG_BLOCK => {
+                        if self.closed.load(Ordering::Acquire) {
+                            // Logging was reconfigured; nothing drains this queue now.
+                            DROPPED_RECORDS.fetch_add(1, Ordering::Relaxed);
+                            break;
+                        }
+                        self.worker.unpark();
+                        thread::sleep(QUEUE_POLL_INTERVAL);
+                        record = rejected;
+                    }
+                },
             }
         }
-        max_level
+        self.worker.unpark();
+    }
+
+    /// Waits until queued records have been delivered, up to `FLUSH_TIMEOUT`.
+    fn flush(&self) {
+        let deadline = Instant::now() + FLUSH_TIMEOUT;
+        while (self.queue.len() > 0 || self.busy.load(Ordering::Acquire))
+            && Instant::now() < deadline
+        {
+            self.worker.unpark();
+            thread::sleep(QUEUE_POLL_INTERVAL);
+        }
+    }
+
+    /// Lets the logging thread exit once it has drained the queue.
+    fn close(&self) {
+        self.closed.store(true, Ordering::Release);
+        self.worker.unpark();
     }
 }
 
@@ -192,92 +974,168 @@ struct LoggerConfig {
     filter: LogFilter,
     callback: cspot_log_callback_t,
     user_data: usize,
+    delivery: Option<Arc<AsyncDelivery>>,
 }
 
 impl LoggerConfig {
-    fn new(filter: LogFilter, callback: cspot_log_callback_t, user_data: usize) -> Self {
+    fn new(
+        filter: LogFilter,
+        callback: cspot_log_callback_t,
+        user_data: usize,
+        delivery: Option<Arc<AsyncDelivery>>,
+    ) -> Self {
         Self {
             filter,
             callback,
             user_data,
+            delivery,
         }
     }
 }
 
 struct CspotLogger {
-    config: RwLock<LoggerConfig>,
+    /// Replaced wholesale on reconfiguration so the logging path never takes a lock.
+    config: ArcSwap<LoggerConfig>,
 }
 
 impl CspotLogger {
     fn new() -> Self {
         Self {
-            config: RwLock::new(LoggerConfig::new(
-                LogFilter::default_for_level(LevelFilter::Info),
+            config: ArcSwap::from_pointee(LoggerConfig::new(
+                LogFilter::default_for_level(LevelFilter::Info, None),
                 None,
                 0,
+                None,
             )),
         }
     }
 
     fn update(&self, config: LoggerConfig) {
-        let mut guard = self
-            .config
-            .write()
-            .unwrap_or_else(|err| err.into_inner());
-        *guard = config;
+        let previous = self.config.swap(Arc::new(config));
+        if let Some(previous) = &previous.delivery {
+            previous.close();
+        }
     }
 
     fn with_config<T>(&self, f: impl FnOnce(&LoggerConfig) -> T) -> T {
-        let guard = self.config.read().unwrap_or_else(|err| err.into_inner());
-        f(&guard)
+        f(&self.config.load())
     }
-}
 
-impl Log for CspotLogger {
-    fn enabled(&self, metadata: &Metadata) -> bool {
-        self.with_config(|config| config.filter.enabled(metadata))
+    /// Hands a record to the configured delivery.
+    fn dispatch(
+        record: &Record,
+        callback: cspot_log_callback_t,
+        user_data: usize,
+        delivery: Option<&Arc<AsyncDelivery>>,
+    ) {
+        // Records emitted by the logging thread itself, for example from inside the
+        // callback, are delivered inline so a full queue cannot deadlock it.
+        if let Some(delivery) = delivery.filter(|_| !IS_LOG_THREAD.with(|flag| flag.get())) {
+            delivery.enqueue(QueuedRecord::new(record));
+            return;
+        }
+
+        deliver_record(record, callback, user_data);
     }
 
-    fn log(&self, record: &Record) {
-        let (callback, user_data, enabled) = self.with_config(|config| {
+    /// Dispatches the summaries `take` collects from the current filter, and returns the
+    /// delivery they went to.
+    fn emit_summaries(
+        &self,
+        take: impl FnOnce(&LogFilter) -> Vec<(String, u64)>,
+    ) -> Option<Arc<AsyncDelivery>> {
+        let (callback, user_data, suppressed, delivery) = self.with_config(|config| {
             (
                 config.callback,
                 config.user_data,
-                config.filter.enabled(record.metadata()),
+                take(&config.filter),
+                config.delivery.clone(),
             )
         });
+        for (target, count) in suppressed {
+            Self::dispatch_summary(&target, count, callback, user_data, delivery.as_ref());
+        }
+        delivery
+    }
 
-        if !enabled {
+    /// Reports records a rate limit suppressed for `target`.
+    fn dispatch_summary(
+        target: &str,
+        count: u64,
+        callback: cspot_log_callback_t,
+        user_data: usize,
+        delivery: Option<&Arc<AsyncDelivery>>,
+    ) {
+        Self::dispatch(
+            &Record::builder()
+                .args(format_args!("suppressed {count} records from {target}"))
+                .level(Level::Warn)
+                .target(module_path!())
+                .module_path_static(Some(module_path!()))
+                .build(),
+            callback,
+            user_data,
+            delivery,
+        );
+    }
+}
+
+impl Log for CspotLogger {
+    fn enabled(&self, metadata: &Metadata) -> bool {
+        self.with_config(|config| config.filter.enabled(metadata))
+    }
+
+    fn log(&self, record: &Record) {
+        let accepted = self.with_config(|config| {
+            if !config.filter.enabled(record.metadata()) {
+                return None;
+            }
+            let admission = config.filter.admit(record.level(), record.target());
+            (!matches!(admission, Admission::Reject)).then(|| {
+                (
+                    config.callback,
+                    config.user_data,
+                    admission,
+                    config.delivery.clone(),
+                )
+            })
+        });
+        let Some((callback, user_data, admission, delivery)) = accepted else {
             return;
+        };
+        trace::log_record(record);
+
+        if let Admission::Resume { target, count } = admission {
+            Self::dispatch_summary(&target, count, callback, user_data, delivery.as_ref());
         }
 
-        if let Some(callback) = callback {
-            let user_data = user_data as *mut c_void;
-            let level = cspot_log_level_t::from(record.level());
-            let target = cstring_from_str_lossy(record.target());
-            let message = cstring_from_str_lossy(&record.args().to_string());
-            let module_path = record.module_path().map(cstring_from_str_lossy);
-            let file = record.file().map(cstring_from_str_lossy);
-            let record = cspot_log_record_t {
-                level,
-                target: target.as_ptr(),
-                message: message.as_ptr(),
-                module_path: module_path.as_ref().map_or(ptr::null(), |value| value.as_ptr()),
-                file: file.as_ref().map_or(ptr::null(), |value| value.as_ptr()),
-                line: record.line().unwrap_or(0),
-            };
-            callback(&record, user_data);
-        } else {
-            eprintln!(
-                "{} {}: {}",
-                record.level(),
-                record.target(),
-                record.args()
-            );
+        Self::dispatch(record, callback, user_data, delivery.as_ref());
+    }
+
+    fn flush(&self) {
+        let delivery = self.emit_summaries(LogFilter::take_suppressed);
+        if let Some(delivery) = delivery {
+            delivery.flush();
         }
     }
+}
 
-    fn flush(&self) {}
+/// Starts the thread that reports suppressed records of targets that went quiet. It
+/// runs for the life of the process once any rate limit has been configured.
+fn start_summary_thread() {
+    SUMMARY_START.call_once(|| {
+        let spawned = thread::Builder::new()
+            .name("cspot-log-summary".to_string())
+            .spawn(|| {
+                loop {
+                    thread::sleep(SUMMARY_INTERVAL);
+                    CSPOT_LOGGER.emit_summaries(LogFilter::take_refilled);
+                }
+            });
+        if let Err(err) = spawned {
+            eprintln!("failed to start cspot log summary thread: {err}");
+        }
+    });
 }
 
 fn parse_level(value: &str) -> Option<LevelFilter> {
@@ -302,22 +1160,28 @@ fn read_optional_cstr(value: *const c_char) -> Option<String> {
 }
 
 fn resolve_filter(config: Option<&cspot_log_config_t>) -> Result<LogFilter, String> {
+    let limit = config.map(|config| RateLimit {
+        rate: config.rate_limit,
+        burst: config.rate_burst,
+        sample: config.sample_every,
+    });
+
     if let Some(config) = config {
         if let Some(filter) = read_optional_cstr(config.filter) {
-            return LogFilter::parse(&filter)
+            return LogFilter::parse(&filter, limit)
                 .map_err(|err| format!("invalid log filter `{filter}`: {err}"));
         }
     }
 
     if let Ok(filter) = std::env::var("RUST_LOG") {
-        return LogFilter::parse(&filter)
+        return LogFilter::parse(&filter, limit)
             .map_err(|err| format!("invalid RUST_LOG value `{filter}`: {err}"));
     }
 
     let level = config
         .map(|config| config.level)
         .unwrap_or(cspot_log_level_t::CSPOT_LOG_LEVEL_INFO);
-    Ok(LogFilter::default_for_level(level.into()))
+    Ok(LogFilter::default_for_level(level.into(), limit))
 }
 
 fn ensure_logger(out_error: *mut *mut cspot_error_t) -> bool {
@@ -348,7 +1212,8 @@ fn ensure_logger(out_error: *mut *mut cspot_error_t) -> bool {
 
 /// Initializes default logging configuration values.
 ///
-/// The defaults select INFO logging for librespot and use no callback.
+/// The defaults select INFO logging for librespot, use no callback, deliver records
+/// synchronously, and apply no rate limits.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_log_config_init(config: *mut cspot_log_config_t) {
     if config.is_null() {
@@ -361,6 +1226,12 @@ pub extern "C" fn cspot_log_config_init(config: *mut cspot_log_config_t) {
             filter: ptr::null(),
             callback: None,
             user_data: ptr::null_mut(),
+            delivery: cspot_log_delivery_t::CSPOT_LOG_DELIVERY_SYNC,
+            queue_capacity: 0,
+            drop_policy: cspot_log_drop_policy_t::CSPOT_LOG_DROP_OLDEST,
+            rate_limit: 0,
+            rate_burst: 0,
+            sample_every: 0,
         };
     }
 }
@@ -391,9 +1262,178 @@ pub extern "C" fn cspot_log_init(
 
     let callback = config.and_then(|config| config.callback);
     let user_data = config.map(|config| config.user_data as usize).unwrap_or(0);
+    let delivery = match config {
+        Some(config) if config.delivery == cspot_log_delivery_t::CSPOT_LOG_DELIVERY_ASYNC => {
+            let capacity = match config.queue_capacity {
+                0 => DEFAULT_QUEUE_CAPACITY,
+                capacity => capacity,
+            };
+            match AsyncDelivery::start(capacity, config.drop_policy) {
+                Ok(delivery) => Some(delivery),
+                Err(message) => {
+                    write_error(out_error, message);
+                    return false;
+                }
+            }
+        }
+        _ => None,
+    };
 
     let max_level = filter.max_level();
-    CSPOT_LOGGER.update(LoggerConfig::new(filter, callback, user_data));
+    if filter.is_rate_limited() {
+        start_summary_thread();
+    }
+    CSPOT_LOGGER.update(LoggerConfig::new(filter, callback, user_data, delivery));
     log::set_max_level(max_level);
     true
 }
+
+/// Returns how many log records asynchronous delivery has discarded because its queue
+/// was full, since the process started.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_log_dropped_count() -> u64 {
+    DROPPED_RECORDS.load(Ordering::Relaxed)
+}
+
+/// Emits pending rate limit summaries and waits until records queued for asynchronous
+/// delivery have reached the callback.
+///
+/// Returns after at most one second of waiting for the logging thread.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_log_flush() {
+    log::logger().flush();
+}
+
+#[cfg(test)]
+mod tests {
+    use std::alloc::{GlobalAlloc, Layout, System};
+    use std::cell::Cell;
+    use std::ffi::{CStr, CString, c_void};
+    use std::mem::MaybeUninit;
+    use std::ptr;
+
+    use super::*;
+
+    thread_local! {
+        /// Heap allocations made by this thread while `COUNTING` is set.
+        static ALLOCATIONS: Cell<u64> = const { Cell::new(0) };
+        static COUNTING: Cell<bool> = const { Cell::new(false) };
+    }
+
+    /// Counts the allocations of the thread under test; other test threads are ignored.
+    struct CountingAllocator;
+
+    unsafe impl GlobalAlloc for CountingAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            let _ = COUNTING.try_with(|counting| {
+                if counting.get() {
+                    ALLOCATIONS.with(|count| count.set(count.get() + 1));
+                }
+            });
+            // Safety: forwarded unchanged from the caller.
+            unsafe { System.alloc(layout) }
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            // Safety: forwarded unchanged from the caller.
+            unsafe { System.dealloc(ptr, layout) }
+        }
+    }
+
+    #[global_allocator]
+    static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+    extern "C" fn check_record(record: *const cspot_log_record_t, user_data: *mut c_void) {
+        // Safety: the logger passes a valid record, and user_data is the test's counter.
+        let (record, delivered) = unsafe { (&*record, &*(user_data as *const Cell<u64>)) };
+        let message = unsafe { CStr::from_ptr(record.message) };
+        let target = unsafe { CStr::from_ptr(record.target) };
+        assert!(message.to_bytes().starts_with(b"record "));
+        assert_eq!(target.to_bytes(), module_path!().as_bytes());
+        assert!(!record.file.is_null());
+        delivered.set(delivered.get() + 1);
+    }
+
+    #[test]
+    fn sync_trace_records_do_not_allocate() {
+        const WARM_UP: u64 = 16;
+        const RECORDS: u64 = 1000;
+
+        let delivered = Cell::new(0u64);
+        let filter = CString::new("trace").unwrap();
+        let mut config = MaybeUninit::uninit();
+        cspot_log_config_init(config.as_mut_ptr());
+        // Safety: cspot_log_config_init filled every field.
+        let mut config = unsafe { config.assume_init() };
+        config.filter = filter.as_ptr();
+        config.callback = Some(check_record);
+        config.user_data = &delivered as *const Cell<u64> as *mut c_void;
+        assert!(cspot_log_init(&config, ptr::null_mut()));
+
+        for index in 0..WARM_UP {
+            log::trace!("record {index} of {}", "warm-up");
+        }
+        COUNTING.with(|counting| counting.set(true));
+        for index in 0..RECORDS {
+            log::trace!("record {index} of {}", "steady state");
+        }
+        COUNTING.with(|counting| counting.set(false));
+
+        assert_eq!(delivered.get(), WARM_UP + RECORDS);
+        assert_eq!(ALLOCATIONS.with(Cell::get), 0);
+    }
+}
+
+/// Logger filtering for the benchmarks in `benches/`.
+#[cfg(feature = "bench")]
+pub(crate) mod bench {
+    use super::*;
+
+    /// A filter spec evaluated by `CspotLogger::enabled`, and the way it was evaluated
+    /// before configuration lookups became lock-free.
+    pub struct Filters {
+        logger: CspotLogger,
+        /// Default level and `(target, level)` directives, behind the lock the logger
+        /// configuration used to live in.
+        legacy: RwLock<(LevelFilter, Vec<(String, LevelFilter)>)>,
+    }
+
+    impl Filters {
+        pub fn parse(spec: &str) -> Result<Self, String> {
+            let filter = LogFilter::parse(spec, None)?;
+            let directives = filter
+                .directives
+                .iter()
+                .map(|directive| (directive.target.clone(), directive.level))
+                .collect();
+            let legacy = RwLock::new((filter.default, directives));
+            Ok(Self {
+                logger: CspotLogger {
+                    config: ArcSwap::from_pointee(LoggerConfig::new(filter, None, 0, None)),
+                },
+                legacy,
+            })
+        }
+
+        pub fn enabled(&self, metadata: &Metadata) -> bool {
+            self.logger.enabled(metadata)
+        }
+
+        /// Takes the read lock and scans every directive for the longest matching
+        /// prefix, as `CspotLogger::enabled` did before.
+        pub fn legacy_enabled(&self, metadata: &Metadata) -> bool {
+            let legacy = self.legacy.read().unwrap_or_else(|err| err.into_inner());
+            let (default, directives) = &*legacy;
+            let target = metadata.target();
+            let mut best_level = *default;
+            let mut best_len = 0usize;
+            for (prefix, level) in directives {
+                if target.starts_with(prefix.as_str()) && prefix.len() >= best_len {
+                    best_len = prefix.len();
+                    best_level = *level;
+                }
+            }
+            metadata.level().to_level_filter() <= best_level
+        }
+    }
+}
@@ -0,0 +1,559 @@
+//! Track and episode metadata records and the process-wide metadata cache.
+//!
+//! Records are immutable and reference-counted, so spirc status, snapshots and
+//! `cspot_metadata_t` handles share one copy per track. The cache keeps the most
+//! recently used records keyed by Spotify id, so a track playing on several spirc
+//! instances, or looked up again, is built once.
+
+use std::collections::{BTreeMap, HashMap};
+use std::ffi::CString;
+use std::os::raw::{c_char, c_void};
+use std::panic::AssertUnwindSafe;
+use std::ptr;
+use std::sync::{Arc, Mutex};
+
+use librespot::core::{SpotifyId, SpotifyUri, session::Session};
+use librespot::metadata::audio::{AudioItem, UniqueFields};
+use librespot::metadata::image::ImageSize;
+use once_cell::sync::Lazy;
+
+use crate::artwork::cspot_artwork_size_t;
+use crate::async_op::{cspot_async_callback_t, cspot_async_op_t, spawn_async_op, take_async_value};
+use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
+use crate::ffi::read_cstr;
+use crate::runtime::runtime;
+use crate::session::{cspot_session_t, session_from_handle};
+
+/// Records kept by the metadata cache unless changed with
+/// `cspot_metadata_cache_set_capacity`.
+const DEFAULT_CAPACITY: usize = 512;
+
+/// Opaque, reference-counted track metadata record for C callers.
+#[allow(non_camel_case_types)]
+pub struct cspot_metadata_t;
+
+/// Metadata cache counters reported by `cspot_metadata_cache_stats`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_metadata_cache_stats_t {
+    /// Lookups answered from the cache.
+    pub hits: u64,
+    /// Lookups that had to build or fetch the record.
+    pub misses: u64,
+    /// Records removed to stay within the capacity.
+    pub evictions: u64,
+    /// Records currently cached.
+    pub entries: usize,
+    /// Maximum number of cached records.
+    pub capacity: usize,
+}
+
+/// One size variant of a track's cover art, filled by `cspot_metadata_cover`.
+///
+/// `url` is owned by the metadata record and remains valid until it is freed.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_cover_t {
+    pub url: *const c_char,
+    pub size: cspot_artwork_size_t,
+    /// Width in pixels, or 0 if unknown.
+    pub width: u32,
+    /// Height in pixels, or 0 if unknown.
+    pub height: u32,
+}
+
+/// A cover art variant of a track.
+#[derive(Clone, Debug)]
+pub(crate) struct Cover {
+    pub(crate) url: CString,
+    pub(crate) size: cspot_artwork_size_t,
+    pub(crate) width: u32,
+    pub(crate) height: u32,
+}
+
+impl From<ImageSize> for cspot_artwork_size_t {
+    fn from(value: ImageSize) -> Self {
+        match value {
+            ImageSize::SMALL => Self::CSPOT_ARTWORK_SIZE_SMALL,
+            ImageSize::LARGE => Self::CSPOT_ARTWORK_SIZE_LARGE,
+            ImageSize::XLARGE => Self::CSPOT_ARTWORK_SIZE_XLARGE,
+            _ => Self::CSPOT_ARTWORK_SIZE_DEFAULT,
+        }
+    }
+}
+
+/// Display metadata for a track or episode. String fields are stored NUL-terminated
+/// so C callers can borrow them directly.
+#[derive(Clone, Debug, Default)]
+pub(crate) struct TrackMetadata {
+    spotify_id: Option<CString>,
+    uri: Option<CString>,
+    artist: Option<CString>,
+    album: Option<CString>,
+    artwork_url: Option<CString>,
+    title: Option<CString>,
+    pub(crate) covers: Vec<Cover>,
+    pub(crate) duration_ms: u32,
+}
+
+fn non_empty(value: String) -> Option<CString> {
+    if value.trim().is_empty() {
+        None
+    } else {
+        Some(cstring_from_str_lossy(&value))
+    }
+}
+
+fn as_str(value: &Option<CString>) -> Option<&str> {
+    value.as_deref().and_then(|value| value.to_str().ok())
+}
+
+fn as_ptr(value: &Option<CString>) -> *const c_char {
+    value.as_deref().map_or(ptr::null(), |value| value.as_ptr())
+}
+
+fn spotify_item_id(uri: &SpotifyUri) -> Option<SpotifyId> {
+    match uri {
+        SpotifyUri::Track { id } | SpotifyUri::Episode { id } => Some(*id),
+        _ => None,
+    }
+}
+
+impl TrackMetadata {
+    /// Builds a placeholder record that only identifies the track.
+    pub(crate) fn identity(track_uri: &SpotifyUri) -> Self {
+        Self {
+            spotify_id: spotify_item_id(track_uri).and_then(|id| non_empty(id.to_base62())),
+            uri: non_empty(track_uri.to_uri()),
+            ..Self::default()
+        }
+    }
+
+    fn from_audio_item(audio_item: &AudioItem) -> Self {
+        let (artist, album) = match &audio_item.unique_fields {
+            UniqueFields::Track { artists, album, .. } => {
+                let mut names = Vec::new();
+                for artist in artists.iter() {
+                    if artist.name.is_empty() {
+                        continue;
+                    }
+                    if !names.iter().any(|value: &String| value == &artist.name) {
+                        names.push(artist.name.clone());
+                    }
+                }
+                (non_empty(names.join(", ")), non_empty(album.clone()))
+            }
+            UniqueFields::Local { artists, album, .. } => (
+                artists.clone().and_then(non_empty),
+                album.clone().and_then(non_empty),
+            ),
+            UniqueFields::Episode { show_name, .. } => (None, non_empty(show_name.clone())),
+        };
+
+        Self {
+            spotify_id: spotify_item_id(&audio_item.track_id)
+                .and_then(|id| non_empty(id.to_base62())),
+            uri: non_empty(audio_item.uri.clone()),
+            artist,
+            album,
+            artwork_url: audio_item
+                .covers
+                .first()
+                .and_then(|cover| non_empty(cover.url.clone())),
+            title: non_empty(audio_item.name.clone()),
+            covers: audio_item
+                .covers
+                .iter()
+                .filter_map(|cover| {
+                    Some(Cover {
+                        url: non_empty(cover.url.clone())?,
+                        size: cover.size.into(),
+                        width: u32::try_from(cover.width).unwrap_or(0),
+                        height: u32::try_from(cover.height).unwrap_or(0),
+                    })
+                })
+                .collect(),
+            duration_ms: audio_item.duration_ms,
+        }
+    }
+
+    pub(crate) fn spotify_id(&self) -> Option<&str> {
+        as_str(&self.spotify_id)
+    }
+
+    pub(crate) fn uri(&self) -> Option<&str> {
+        as_str(&self.uri)
+    }
+
+    pub(crate) fn artist(&self) -> Option<&str> {
+        as_str(&self.artist)
+    }
+
+    pub(crate) fn album(&self) -> Option<&str> {
+        as_str(&self.album)
+    }
+
+    pub(crate) fn artwork_url(&self) -> Option<&str> {
+        as_str(&self.artwork_url)
+    }
+
+    pub(crate) fn title(&self) -> Option<&str> {
+        as_str(&self.title)
+    }
+}
+
+#[cfg(feature = "bench")]
+impl TrackMetadata {
+    /// Builds a record with every string field set, for the benchmarks.
+    pub(crate) fn sample() -> Self {
+        let field = |value: &str| Some(cstring_from_str_lossy(value));
+        Self {
+            spotify_id: field("4uLU6hMCjMI75M1A2tKUQC"),
+            uri: field("spotify:track:4uLU6hMCjMI75M1A2tKUQC"),
+            artist: field("Rick Astley"),
+            album: field("Whenever You Need Somebody"),
+            artwork_url: field("https://i.scdn.co/image/ab67616d0000b2735755e164993798e0c9ef7d7a"),
+            title: field("Never Gonna Give You Up"),
+            covers: Vec::new(),
+            duration_ms: 213_573,
+        }
+    }
+}
+
+struct CacheEntry {
+    record: Arc<TrackMetadata>,
+    last_used: u64,
+}
+
+/// Size-bounded LRU of metadata records keyed by Spotify id.
+struct MetadataCache {
+    entries: HashMap<SpotifyId, CacheEntry>,
+    /// Entries ordered by last use, oldest first.
+    recency: BTreeMap<u64, SpotifyId>,
+    clock: u64,
+    capacity: usize,
+    hits: u64,
+    misses: u64,
+    evictions: u64,
+}
+
+impl MetadataCache {
+    fn new(capacity: usize) -> Self {
+        Self {
+            entries: HashMap::new(),
+            recency: BTreeMap::new(),
+            clock: 0,
+            capacity,
+            hits: 0,
+            misses: 0,
+            evictions: 0,
+        }
+    }
+
+    fn tick(&mut self) -> u64 {
+        self.clock += 1;
+        self.clock
+    }
+
+    fn get(&mut self, id: &SpotifyId) -> Option<Arc<TrackMetadata>> {
+        let now = self.tick();
+        let Some(entry) = self.entries.get_mut(id) else {
+            self.misses += 1;
+            return None;
+        };
+        self.hits += 1;
+        self.recency.remove(&entry.last_used);
+        self.recency.insert(now, *id);
+        entry.last_used = now;
+        Some(Arc::clone(&entry.record))
+    }
+
+    fn insert(&mut self, id: SpotifyId, record: Arc<TrackMetadata>) {
+        if self.capacity == 0 {
+            return;
+        }
+        let now = self.tick();
+        if let Some(previous) = self.entries.insert(
+            id,
+            CacheEntry {
+                record,
+                last_used: now,
+            },
+        ) {
+            self.recency.remove(&previous.last_used);
+        }
+        self.recency.insert(now, id);
+        self.trim();
+    }
+
+    fn trim(&mut self) {
+        while self.entries.len() > self.capacity {
+            let Some((_, id)) = self.recency.pop_first() else {
+                break;
+            };
+            self.entries.remove(&id);
+            self.evictions += 1;
+        }
+    }
+
+    fn stats(&self) -> cspot_metadata_cache_stats_t {
+        cspot_metadata_cache_stats_t {
+            hits: self.hits,
+            misses: self.misses,
+            evictions: self.evictions,
+            entries: self.entries.len(),
+            capacity: self.capacity,
+        }
+    }
+}
+
+static METADATA_CACHE: Lazy<Mutex<MetadataCache>> =
+    Lazy::new(|| Mutex::new(MetadataCache::new(DEFAULT_CAPACITY)));
+
+fn lock_cache() -> std::sync::MutexGuard<'static, MetadataCache> {
+    METADATA_CACHE
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Returns the shared record for `audio_item`, building and caching it on a miss.
+pub(crate) fn metadata_for_audio_item(audio_item: &AudioItem) -> Arc<TrackMetadata> {
+    let Some(id) = spotify_item_id(&audio_item.track_id) else {
+        return Arc::new(TrackMetadata::from_audio_item(audio_item));
+    };
+    if let Some(record) = lock_cache().get(&id) {
+        return record;
+    }
+    let record = Arc::new(TrackMetadata::from_audio_item(audio_item));
+    lock_cache().insert(id, Arc::clone(&record));
+    record
+}
+
+/// Returns the record for `uri`, fetching it through `session` on a miss.
+pub(crate) async fn lookup(session: Session, uri: String) -> Result<Arc<TrackMetadata>, String> {
+    let uri = SpotifyUri::from_uri(&uri).map_err(|err| format!("invalid URI {uri}: {err}"))?;
+    let Some(id) = spotify_item_id(&uri) else {
+        return Err("only track and episode URIs have metadata".to_string());
+    };
+    if let Some(record) = lock_cache().get(&id) {
+        return Ok(record);
+    }
+    let audio_item = AudioItem::get_file(&session, uri)
+        .await
+        .map_err(|err| format!("failed to load metadata: {err}"))?;
+    let record = Arc::new(TrackMetadata::from_audio_item(&audio_item));
+    lock_cache().insert(id, Arc::clone(&record));
+    Ok(record)
+}
+
+/// Hands a shared record to C without copying it.
+pub(crate) fn metadata_into_handle(record: Arc<TrackMetadata>) -> *mut cspot_metadata_t {
+    Arc::into_raw(record) as *mut cspot_metadata_t
+}
+
+fn metadata_from_handle<'a>(metadata: *const cspot_metadata_t) -> Option<&'a TrackMetadata> {
+    if metadata.is_null() {
+        return None;
+    }
+    // Safety: metadata must be a valid handle allocated by cspot and outlives the call.
+    Some(unsafe { &*(metadata as *const TrackMetadata) })
+}
+
+fn read_lookup_args(
+    session: *const cspot_session_t,
+    uri: *const c_char,
+    out_error: *mut *mut cspot_error_t,
+) -> Option<(Session, String)> {
+    let uri = read_cstr(uri, "uri", out_error)?;
+    let Some(session) = session_from_handle(session) else {
+        write_error(out_error, "session handle was null");
+        return None;
+    };
+    Some((session, uri))
+}
+
+/// Looks up the metadata of a track or episode URI.
+///
+/// Cached records are returned without network access; otherwise the metadata is
+/// fetched and cached. The returned handle must be released with
+/// `cspot_metadata_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_lookup(
+    session: *const cspot_session_t,
+    uri: *const c_char,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_metadata_t {
+    clear_error(out_error);
+    let Some((session, uri)) = read_lookup_args(session, uri, out_error) else {
+        return ptr::null_mut();
+    };
+
+    let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
+        runtime().block_on(lookup(session, uri))
+    }));
+
+    match result {
+        Ok(Ok(record)) => metadata_into_handle(record),
+        Ok(Err(err)) => {
+            write_error(out_error, err);
+            ptr::null_mut()
+        }
+        Err(_) => {
+            write_error(out_error, "panic while looking up metadata");
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Looks up the metadata of a track or episode URI without blocking.
+///
+/// Claim the record with `cspot_async_op_take_metadata`. The operation handle must be
+/// released with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_lookup_async(
+    session: *const cspot_session_t,
+    uri: *const c_char,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let Some((session, uri)) = read_lookup_args(session, uri, out_error) else {
+        return ptr::null_mut();
+    };
+    spawn_async_op(lookup(session, uri), callback, user_data)
+}
+
+/// Claims the record produced by `cspot_metadata_lookup_async`.
+///
+/// Returns null and writes an error if the operation has not completed successfully.
+/// The returned handle must be released with `cspot_metadata_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_metadata(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_metadata_t {
+    match take_async_value::<Arc<TrackMetadata>>(op, out_error) {
+        Some(record) => metadata_into_handle(record),
+        None => ptr::null_mut(),
+    }
+}
+
+/// Returns the Spotify ID of a record, or null if unavailable.
+///
+/// Strings returned by the `cspot_metadata_*` getters are owned by the record and
+/// remain valid until it is freed.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_id(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.spotify_id))
+}
+
+/// Returns the Spotify URI of a record, or null if unavailable.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_uri(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.uri))
+}
+
+/// Returns the artist list of a record, or null if unavailable.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_artist(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.artist))
+}
+
+/// Returns the album or show name of a record, or null if unavailable.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_album(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.album))
+}
+
+/// Returns the artwork URL of a record, or null if unavailable.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_artwork_url(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.artwork_url))
+}
+
+/// Returns the title of a record, or null if unavailable.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_title(metadata: *const cspot_metadata_t) -> *const c_char {
+    metadata_from_handle(metadata).map_or(ptr::null(), |record| as_ptr(&record.title))
+}
+
+/// Returns how many cover art size variants a record has.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_cover_count(metadata: *const cspot_metadata_t) -> usize {
+    metadata_from_handle(metadata).map_or(0, |record| record.covers.len())
+}
+
+/// Reads the cover art variant at `index`, in the order Spotify lists them.
+///
+/// Returns false if the handle or `out_cover` is null or the index is out of range.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_cover(
+    metadata: *const cspot_metadata_t,
+    index: usize,
+    out_cover: *mut cspot_cover_t,
+) -> bool {
+    let Some(cover) = metadata_from_handle(metadata).and_then(|record| record.covers.get(index))
+    else {
+        return false;
+    };
+    if out_cover.is_null() {
+        return false;
+    }
+    // Safety: out_cover is non-null and points to writable memory.
+    unsafe {
+        *out_cover = cspot_cover_t {
+            url: cover.url.as_ptr(),
+            size: cover.size,
+            width: cover.width,
+            height: cover.height,
+        };
+    }
+    true
+}
+
+/// Returns the duration of a record in milliseconds, or 0 if unknown.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_duration_ms(metadata: *const cspot_metadata_t) -> u32 {
+    metadata_from_handle(metadata).map_or(0, |record| record.duration_ms)
+}
+
+/// Releases a metadata handle. The record itself is freed once no spirc or cache
+/// entry refers to it.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_free(metadata: *mut cspot_metadata_t) {
+    if metadata.is_null() {
+        return;
+    }
+    // Safety: metadata must be a valid handle allocated by cspot.
+    unsafe {
+        drop(Arc::from_raw(metadata as *const TrackMetadata));
+    }
+}
+
+/// Sets how many records the process-wide metadata cache keeps.
+///
+/// Least recently used records are evicted when the cache shrinks. 0 disables
+/// caching.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_cache_set_capacity(capacity: usize) {
+    let mut cache = lock_cache();
+    cache.capacity = capacity;
+    cache.trim();
+}
+
+/// Reads the counters of the process-wide metadata cache.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metadata_cache_stats(out_stats: *mut cspot_metadata_cache_stats_t) -> bool {
+    if out_stats.is_null() {
+        return false;
+    }
+    let stats = lock_cache().stats();
+    // Safety: out_stats is non-null and points to writable memory.
+    unsafe {
+        *out_stats = stats;
+    }
+    true
+}
@@ -0,0 +1,702 @@
+//! Process-wide counters, gauges and latency histograms.
+//!
+//! Every metric is a fixed set of atomics in one static registry, so recording is a
+//! relaxed atomic add on the path being measured and reading them never blocks the
+//! code that records. `cspot_metrics_snapshot` copies the registry into a plain struct;
+//! `cspot_metrics_for_each` walks a snapshot as name/value pairs for callers that
+//! should not depend on the struct layout.
+
+use std::os::raw::{c_char, c_void};
+use std::sync::atomic::{AtomicI64, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::time::{Duration, Instant};
+
+use librespot::playback::player::PlayerEvent;
+
+use crate::logging::cspot_log_dropped_count;
+use crate::trace;
+
+/// Number of buckets in every `cspot_histogram_t`.
+pub const CSPOT_METRICS_HISTOGRAM_BUCKETS: usize = 16;
+
+/// Inclusive upper bounds of the histogram buckets in microseconds. The last bucket
+/// holds everything larger.
+const BUCKET_BOUNDS_US: [u64; CSPOT_METRICS_HISTOGRAM_BUCKETS] = [
+    50,
+    100,
+    250,
+    500,
+    1_000,
+    2_500,
+    5_000,
+    10_000,
+    25_000,
+    50_000,
+    100_000,
+    250_000,
+    500_000,
+    1_000_000,
+    5_000_000,
+    u64::MAX,
+];
+
+/// Latency distribution reported in `cspot_metrics_t`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_histogram_t {
+    /// Number of recorded samples.
+    pub count: u64,
+    /// Sum of all samples in microseconds.
+    pub sum_us: u64,
+    /// Largest sample in microseconds.
+    pub max_us: u64,
+    /// Samples per bucket. Bucket `i` counts samples larger than the bound of bucket
+    /// `i - 1` and at most `cspot_metrics_bucket_bound_us(i)`.
+    pub buckets: [u64; CSPOT_METRICS_HISTOGRAM_BUCKETS],
+}
+
+impl cspot_histogram_t {
+    /// Estimates the `quantile` (0 to 1) in microseconds by interpolating within the
+    /// bucket that contains it.
+    pub(crate) fn quantile_us(&self, quantile: f64) -> f64 {
+        if self.count == 0 {
+            return 0.0;
+        }
+        let rank = (quantile.clamp(0.0, 1.0) * self.count as f64).max(1.0);
+        let mut seen = 0u64;
+        for (index, &count) in self.buckets.iter().enumerate() {
+            if count == 0 || ((seen + count) as f64) < rank {
+                seen += count;
+                continue;
+            }
+            let lower = if index == 0 {
+                0
+            } else {
+                BUCKET_BOUNDS_US[index - 1]
+            };
+            let upper = BUCKET_BOUNDS_US[index].min(self.max_us).max(lower);
+            let fraction = (rank - seen as f64) / count as f64;
+            return lower as f64 + (upper - lower) as f64 * fraction;
+        }
+        self.max_us as f64
+    }
+}
+
+/// Counters, gauges and histograms reported by `cspot_metrics_snapshot`.
+///
+/// Counters only grow for the life of the process. Gauges report a current value.
+/// Histograms are in microseconds.
+///
+/// Audio that librespot's player fetches for playback goes through librespot alone and
+/// is not measured here; `cspot_cache_stats` reports it once it lands in the audio
+/// cache.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_metrics_t {
+    /// Audio bytes downloaded by `cspot_cache_prefetch`.
+    pub prefetch_bytes_downloaded: u64,
+    /// Artwork bytes downloaded by `cspot_artwork_*`.
+    pub artwork_bytes_downloaded: u64,
+    /// PCM reads that found fewer frames than requested while playing.
+    pub underruns: u64,
+    /// Frames filled with silence by those reads.
+    pub underrun_frames: u64,
+    /// PCM writes that timed out waiting for the reader.
+    pub overruns: u64,
+    /// Session connections reported by Connect.
+    pub session_connects: u64,
+    /// Session disconnections reported by Connect.
+    pub session_disconnects: u64,
+    /// Session connections that followed a disconnection.
+    pub session_reconnects: u64,
+    /// Commands sent through the `cspot_spirc_*` functions.
+    pub spirc_commands: u64,
+    /// Commands that librespot rejected.
+    pub spirc_command_errors: u64,
+    /// Log records discarded by asynchronous log delivery.
+    pub log_records_dropped: u64,
+    /// Live session handles.
+    pub sessions: i64,
+    /// `cspot_cache_prefetch` requests currently running.
+    pub prefetch_downloads: i64,
+    /// Time for `cspot_cache_prefetch` to open an audio file for download, up to its
+    /// first response.
+    pub prefetch_open_latency: cspot_histogram_t,
+    /// Time from the player loading a track until it plays or pauses.
+    pub track_load_latency: cspot_histogram_t,
+    /// Time the player spends producing each packet between sink writes: decoding
+    /// plus any wait for audio data.
+    pub decode_time: cspot_histogram_t,
+    /// Time to convert a packet and hand it to the sink, including waiting for ring
+    /// space.
+    pub sink_write_time: cspot_histogram_t,
+    /// Time to hand a command to Connect.
+    pub spirc_command_latency: cspot_histogram_t,
+}
+
+/// Kind of a value passed to a `cspot_metric_visitor_t`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_metric_kind_t {
+    /// Only grows.
+    CSPOT_METRIC_COUNTER = 0,
+    /// May go up and down.
+    CSPOT_METRIC_GAUGE = 1,
+}
+
+/// One named value from a metrics snapshot.
+#[allow(non_camel_case_types)]
+#[repr(C)]
+pub struct cspot_metric_t {
+    /// Name such as `prefetch_bytes_downloaded` or `decode_time_us.p99`. Only valid for the
+    /// duration of the visitor call.
+    pub name: *const c_char,
+    pub kind: cspot_metric_kind_t,
+    pub value: f64,
+}
+
+/// Callback invoked by `cspot_metrics_for_each` for each value.
+#[allow(non_camel_case_types)]
+pub type cspot_metric_visitor_t =
+    Option<extern "C" fn(metric: *const cspot_metric_t, user_data: *mut c_void)>;
+
+pub(crate) struct Counter(AtomicU64);
+
+impl Counter {
+    const fn new() -> Self {
+        Self(AtomicU64::new(0))
+    }
+
+    pub(crate) fn add(&self, value: u64) {
+        self.0.fetch_add(value, Ordering::Relaxed);
+    }
+
+    pub(crate) fn inc(&self) {
+        self.add(1);
+    }
+
+    fn get(&self) -> u64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+pub(crate) struct Gauge(AtomicI64);
+
+impl Gauge {
+    const fn new() -> Self {
+        Self(AtomicI64::new(0))
+    }
+
+    pub(crate) fn inc(&self) {
+        self.0.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub(crate) fn dec(&self) {
+        self.0.fetch_sub(1, Ordering::Relaxed);
+    }
+
+    fn get(&self) -> i64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+pub(crate) struct Histogram {
+    count: AtomicU64,
+    sum_us: AtomicU64,
+    max_us: AtomicU64,
+    buckets: [AtomicU64; CSPOT_METRICS_HISTOGRAM_BUCKETS],
+}
+
+impl Histogram {
+    pub(crate) const fn new() -> Self {
+        Self {
+            count: AtomicU64::new(0),
+            sum_us: AtomicU64::new(0),
+            max_us: AtomicU64::new(0),
+            buckets: [const { AtomicU64::new(0) }; CSPOT_METRICS_HISTOGRAM_BUCKETS],
+        }
+    }
+
+    pub(crate) fn record(&self, elapsed: Duration) {
+        let us = u64::try_from(elapsed.as_micros()).unwrap_or(u64::MAX);
+        let bucket = BUCKET_BOUNDS_US.partition_point(|bound| *bound < us);
+        self.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+        self.sum_us.fetch_add(us, Ordering::Relaxed);
+        self.max_us.fetch_max(us, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Records the time since `start`.
+    pub(crate) fn record_since(&self, start: Instant) {
+        self.record(start.elapsed());
+    }
+
+    pub(crate) fn snapshot(&self) -> cspot_histogram_t {
+        cspot_histogram_t {
+            count: self.count.load(Ordering::Relaxed),
+            sum_us: self.sum_us.load(Ordering::Relaxed),
+            max_us: self.max_us.load(Ordering::Relaxed),
+            buckets: std::array::from_fn(|index| self.buckets[index].load(Ordering::Relaxed)),
+        }
+    }
+}
+
+/// The registry. Fields are recorded directly by the code they describe.
+pub(crate) struct Metrics {
+    pub(crate) prefetch_bytes_downloaded: Counter,
+    pub(crate) artwork_bytes_downloaded: Counter,
+    pub(crate) underruns: Counter,
+    pub(crate) underrun_frames: Counter,
+    pub(crate) overruns: Counter,
+    pub(crate) session_connects: Counter,
+    pub(crate) session_disconnects: Counter,
+    pub(crate) session_reconnects: Counter,
+    pub(crate) spirc_commands: Counter,
+    pub(crate) spirc_command_errors: Counter,
+    pub(crate) sessions: Gauge,
+    pub(crate) prefetch_downloads: Gauge,
+    pub(crate) prefetch_open_latency: Histogram,
+    pub(crate) track_load_latency: Histogram,
+    pub(crate) decode_time: Histogram,
+    pub(crate) sink_write_time: Histogram,
+    pub(crate) spirc_command_latency: Histogram,
+}
+
+pub(crate) static METRICS: Metrics = Metrics {
+    prefetch_bytes_downloaded: Counter::new(),
+    artwork_bytes_downloaded: Counter::new(),
+    underruns: Counter::new(),
+    underrun_frames: Counter::new(),
+    overruns: Counter::new(),
+    session_connects: Counter::new(),
+    session_disconnects: Counter::new(),
+    session_reconnects: Counter::new(),
+    spirc_commands: Counter::new(),
+    spirc_command_errors: Counter::new(),
+    sessions: Gauge::new(),
+    prefetch_downloads: Gauge::new(),
+    prefetch_open_latency: Histogram::new(),
+    track_load_latency: Histogram::new(),
+    decode_time: Histogram::new(),
+    sink_write_time: Histogram::new(),
+    spirc_command_latency: Histogram::new(),
+};
+
+impl Metrics {
+    pub(crate) fn snapshot(&self) -> cspot_metrics_t {
+        cspot_metrics_t {
+            prefetch_bytes_downloaded: self.prefetch_bytes_downloaded.get(),
+            artwork_bytes_downloaded: self.artwork_bytes_downloaded.get(),
+            underruns: self.underruns.get(),
+            underrun_frames: self.underrun_frames.get(),
+            overruns: self.overruns.get(),
+            session_connects: self.session_connects.get(),
+            session_disconnects: self.session_disconnects.get(),
+            session_reconnects: self.session_reconnects.get(),
+            spirc_commands: self.spirc_commands.get(),
+            spirc_command_errors: self.spirc_command_errors.get(),
+            log_records_dropped: cspot_log_dropped_count(),
+            sessions: self.sessions.get(),
+            prefetch_downloads: self.prefetch_downloads.get(),
+            prefetch_open_latency: self.prefetch_open_latency.snapshot(),
+            track_load_latency: self.track_load_latency.snapshot(),
+            decode_time: self.decode_time.snapshot(),
+            sink_write_time: self.sink_write_time.snapshot(),
+            spirc_command_latency: self.spirc_command_latency.snapshot(),
+        }
+    }
+}
+
+/// A metric from a snapshot, as read through `METRIC_DESCS`.
+pub(crate) enum MetricValue<'a> {
+    Counter(u64),
+    Gauge(i64),
+    Histogram(&'a cspot_histogram_t),
+}
+
+/// Whether a metric describes the whole process or one Connect instance.
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+pub(crate) enum MetricScope {
+    Process,
+    /// Recorded per instance by `SpircMetrics` and summed into the process snapshot.
+    Spirc,
+}
+
+/// Name, description and accessor of one field of `cspot_metrics_t`.
+pub(crate) struct MetricDesc {
+    pub(crate) name: &'static str,
+    pub(crate) help: &'static str,
+    pub(crate) scope: MetricScope,
+    pub(crate) read: fn(&cspot_metrics_t) -> MetricValue<'_>,
+}
+
+/// Every metric, in the order `cspot_metrics_for_each` reports them.
+pub(crate) const METRIC_DESCS: &[MetricDesc] = &[
+    MetricDesc {
+        name: "prefetch_bytes_downloaded",
+        help: "Audio bytes downloaded by cache prefetches.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.prefetch_bytes_downloaded),
+    },
+    MetricDesc {
+        name: "artwork_bytes_downloaded",
+        help: "Artwork bytes downloaded.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.artwork_bytes_downloaded),
+    },
+    MetricDesc {
+        name: "underruns",
+        help: "PCM reads that found fewer frames than requested while playing.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.underruns),
+    },
+    MetricDesc {
+        name: "underrun_frames",
+        help: "Frames filled with silence by PCM underruns.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.underrun_frames),
+    },
+    MetricDesc {
+        name: "overruns",
+        help: "PCM writes that timed out waiting for the reader.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.overruns),
+    },
+    MetricDesc {
+        name: "session_connects",
+        help: "Session connections reported by Connect.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Counter(m.session_connects),
+    },
+    MetricDesc {
+        name: "session_disconnects",
+        help: "Session disconnections reported by Connect.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Counter(m.session_disconnects),
+    },
+    MetricDesc {
+        name: "session_reconnects",
+        help: "Session connections that followed a disconnection.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Counter(m.session_reconnects),
+    },
+    MetricDesc {
+        name: "spirc_commands",
+        help: "Commands sent to Connect.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Counter(m.spirc_commands),
+    },
+    MetricDesc {
+        name: "spirc_command_errors",
+        help: "Commands that Connect rejected.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Counter(m.spirc_command_errors),
+    },
+    MetricDesc {
+        name: "log_records_dropped",
+        help: "Log records discarded by asynchronous log delivery.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Counter(m.log_records_dropped),
+    },
+    MetricDesc {
+        name: "sessions",
+        help: "Live session handles.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Gauge(m.sessions),
+    },
+    MetricDesc {
+        name: "prefetch_downloads",
+        help: "Prefetch requests currently running.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Gauge(m.prefetch_downloads),
+    },
+    MetricDesc {
+        name: "prefetch_open_latency_us",
+        help: "Time for a cache prefetch to open an audio file for download.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Histogram(&m.prefetch_open_latency),
+    },
+    MetricDesc {
+        name: "track_load_latency_us",
+        help: "Time from the player loading a track until it plays or pauses.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Histogram(&m.track_load_latency),
+    },
+    MetricDesc {
+        name: "decode_time_us",
+        help: "Time the player spends producing each packet between sink writes.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Histogram(&m.decode_time),
+    },
+    MetricDesc {
+        name: "sink_write_time_us",
+        help: "Time to convert a packet and hand it to the sink.",
+        scope: MetricScope::Process,
+        read: |m| MetricValue::Histogram(&m.sink_write_time),
+    },
+    MetricDesc {
+        name: "spirc_command_latency_us",
+        help: "Time to hand a command to Connect.",
+        scope: MetricScope::Spirc,
+        read: |m| MetricValue::Histogram(&m.spirc_command_latency),
+    },
+];
+
+/// Source of `SpircMetrics::id`.
+static NEXT_SPIRC_ID: AtomicU64 = AtomicU64::new(1);
+
+/// Live Connect instances, for exporters that label metrics per instance.
+static SPIRC_METRICS: Mutex<Vec<Weak<SpircMetrics>>> = Mutex::new(Vec::new());
+
+/// Metrics of one Connect instance. Everything recorded here is also added to
+/// `METRICS`, so the process snapshot keeps covering every instance.
+pub(crate) struct SpircMetrics {
+    pub(crate) id: u64,
+    pub(crate) device_name: String,
+    session_connects: Counter,
+    session_disconnects: Counter,
+    session_reconnects: Counter,
+    commands: Counter,
+    command_errors: Counter,
+    command_latency: Histogram,
+    track_load_latency: Histogram,
+}
+
+impl SpircMetrics {
+    /// Creates the metrics of a new Connect instance and makes them visible to
+    /// `spirc_metrics` until they are dropped.
+    pub(crate) fn register(device_name: String) -> Arc<Self> {
+        let metrics = Arc::new(Self {
+            id: NEXT_SPIRC_ID.fetch_add(1, Ordering::Relaxed),
+            device_name,
+            session_connects: Counter::new(),
+            session_disconnects: Counter::new(),
+            session_reconnects: Counter::new(),
+            commands: Counter::new(),
+            command_errors: Counter::new(),
+            command_latency: Histogram::new(),
+            track_load_latency: Histogram::new(),
+        });
+        let mut registry = lock_spirc_metrics();
+        registry.retain(|entry| entry.strong_count() > 0);
+        registry.push(Arc::downgrade(&metrics));
+        metrics
+    }
+
+    /// Records a command that took `elapsed` to hand to Connect.
+    pub(crate) fn record_command(&self, elapsed: Duration, ok: bool) {
+        for (commands, errors, latency) in [
+            (&self.commands, &self.command_errors, &self.command_latency),
+            (
+                &METRICS.spirc_commands,
+                &METRICS.spirc_command_errors,
+                &METRICS.spirc_command_latency,
+            ),
+        ] {
+            commands.inc();
+            if !ok {
+                errors.inc();
+            }
+            latency.record(elapsed);
+        }
+    }
+
+    /// Returns a snapshot with only the `MetricScope::Spirc` fields filled in.
+    pub(crate) fn snapshot(&self) -> cspot_metrics_t {
+        cspot_metrics_t {
+            session_connects: self.session_connects.get(),
+            session_disconnects: self.session_disconnects.get(),
+            session_reconnects: self.session_reconnects.get(),
+            spirc_commands: self.commands.get(),
+            spirc_command_errors: self.command_errors.get(),
+            track_load_latency: self.track_load_latency.snapshot(),
+            spirc_command_latency: self.command_latency.snapshot(),
+            ..cspot_metrics_t::default()
+        }
+    }
+}
+
+fn lock_spirc_metrics() -> std::sync::MutexGuard<'static, Vec<Weak<SpircMetrics>>> {
+    SPIRC_METRICS
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Replaces the contents of `out` with the live Connect instances, oldest first.
+pub(crate) fn spirc_metrics(out: &mut Vec<Arc<SpircMetrics>>) {
+    out.clear();
+    out.extend(lock_spirc_metrics().iter().filter_map(Weak::upgrade));
+}
+
+/// Times the packets written to one sink.
+///
+/// The gap between the end of one write and the start of the next is the time the
+/// player took to produce the packet, which is recorded as decode time.
+#[derive(Default)]
+pub(crate) struct PacketTimer {
+    last_write_end: Option<Instant>,
+}
+
+impl PacketTimer {
+    pub(crate) fn time_write<T>(&mut self, write: impl FnOnce() -> T) -> T {
+        let start = Instant::now();
+        if let Some(end) = self.last_write_end {
+            METRICS
+                .decode_time
+                .record(start.saturating_duration_since(end));
+            trace::complete("playback", "decode", end, start);
+        }
+        let result = write();
+        let end = Instant::now();
+        METRICS
+            .sink_write_time
+            .record(end.saturating_duration_since(start));
+        trace::complete("playback", "sink.write", start, end);
+        self.last_write_end = Some(end);
+        result
+    }
+
+    /// Forgets the last write, so the gap across a pause is not counted as decoding.
+    pub(crate) fn reset(&mut self) {
+        self.last_write_end = None;
+    }
+}
+
+/// Derives session and track load metrics from one Connect instance's player events.
+pub(crate) struct PlayerEventMetrics {
+    spirc: Arc<SpircMetrics>,
+    loading_since: Option<Instant>,
+    disconnected: bool,
+}
+
+impl PlayerEventMetrics {
+    pub(crate) fn new(spirc: Arc<SpircMetrics>) -> Self {
+        Self {
+            spirc,
+            loading_since: None,
+            disconnected: false,
+        }
+    }
+
+    pub(crate) fn observe(&mut self, event: &PlayerEvent) {
+        let spirc = &*self.spirc;
+        match event {
+            PlayerEvent::SessionConnected { .. } => {
+                spirc.session_connects.inc();
+                METRICS.session_connects.inc();
+                if std::mem::take(&mut self.disconnected) {
+                    spirc.session_reconnects.inc();
+                    METRICS.session_reconnects.inc();
+                }
+            }
+            PlayerEvent::SessionDisconnected { .. } => {
+                spirc.session_disconnects.inc();
+                METRICS.session_disconnects.inc();
+                self.disconnected = true;
+            }
+            PlayerEvent::Loading { .. } => self.loading_since = Some(Instant::now()),
+            PlayerEvent::Playing { .. } | PlayerEvent::Paused { .. } => {
+                if let Some(start) = self.loading_since.take() {
+                    let elapsed = start.elapsed();
+                    spirc.track_load_latency.record(elapsed);
+                    METRICS.track_load_latency.record(elapsed);
+                    trace::async_since("playback", "track.load", start, || {
+                        format!("spirc {}", spirc.id)
+                    });
+                }
+            }
+            PlayerEvent::Stopped { .. } | PlayerEvent::Unavailable { .. } => {
+                self.loading_since = None;
+            }
+            _ => {}
+        }
+    }
+}
+
+/// Returns the inclusive upper bound of histogram bucket `index` in microseconds.
+///
+/// The last bucket, and any index past it, reports `UINT64_MAX`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_bucket_bound_us(index: usize) -> u64 {
+    BUCKET_BOUNDS_US.get(index).copied().unwrap_or(u64::MAX)
+}
+
+/// Copies the current value of every metric into `out_metrics`.
+///
+/// Each value is read atomically but the snapshot as a whole is not, so related
+/// values may be a few samples apart. Safe to call from any thread; it never blocks
+/// and does not allocate. Returns false if `out_metrics` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_snapshot(out_metrics: *mut cspot_metrics_t) -> bool {
+    if out_metrics.is_null() {
+        return false;
+    }
+    let metrics = METRICS.snapshot();
+    // Safety: out_metrics is non-null and points to writable memory.
+    unsafe {
+        *out_metrics = metrics;
+    }
+    true
+}
+
+/// Calls `visitor` for each value in `metrics`, a snapshot from `cspot_metrics_snapshot`.
+///
+/// Counters and gauges are reported under their field names. Each histogram is
+/// reported as `<name>_us.count`, `.sum`, `.max`, `.p50`, `.p90` and `.p99`, where the
+/// percentiles are estimated from the buckets. Metrics added to later versions of
+/// cspot appear here without changes to the caller. Returns false if `metrics` or
+/// `visitor` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_for_each(
+    metrics: *const cspot_metrics_t,
+    visitor: cspot_metric_visitor_t,
+    user_data: *mut c_void,
+) -> bool {
+    let Some(visitor) = visitor else {
+        return false;
+    };
+    // Safety: metrics is null or points to a snapshot written by cspot.
+    let Some(metrics) = (unsafe { metrics.as_ref() }) else {
+        return false;
+    };
+
+    let mut name = Vec::with_capacity(64);
+    let mut emit = |base: &str, suffix: &str, kind, value| {
+        name.clear();
+        name.extend_from_slice(base.as_bytes());
+        name.extend_from_slice(suffix.as_bytes());
+        name.push(0);
+        let metric = cspot_metric_t {
+            name: name.as_ptr() as *const c_char,
+            kind,
+            value,
+        };
+        visitor(&metric, user_data);
+    };
+    for desc in METRIC_DESCS {
+        use cspot_metric_kind_t::*;
+
+        let base = desc.name;
+        match (desc.read)(metrics) {
+            MetricValue::Counter(value) => emit(base, "", CSPOT_METRIC_COUNTER, value as f64),
+            MetricValue::Gauge(value) => emit(base, "", CSPOT_METRIC_GAUGE, value as f64),
+            MetricValue::Histogram(histogram) => {
+                emit(base, ".count", CSPOT_METRIC_COUNTER, histogram.count as f64);
+                emit(base, ".sum", CSPOT_METRIC_COUNTER, histogram.sum_us as f64);
+                emit(base, ".max", CSPOT_METRIC_GAUGE, histogram.max_us as f64);
+                for (suffix, quantile) in [(".p50", 0.5), (".p90", 0.9), (".p99", 0.99)] {
+                    emit(
+                        base,
+                        suffix,
+                        CSPOT_METRIC_GAUGE,
+                        histogram.quantile_us(quantile),
+                    );
+                }
+            }
+        }
+    }
+    true
+}
@@ -0,0 +1,371 @@
+//! Embedded HTTP endpoint that serves the metrics registry in the OpenMetrics text
+//! format, for monitoring systems that scrape `/metrics`.
+//!
+//! The server runs on the cspot runtime and answers one request per connection, for
+//! a bounded number of connections at a time. Each scrape renders into buffers taken
+//! from a pool kept by the server and returned after the response, so steady-state
+//! scrapes do not allocate beyond the buffers' growth, and no lock is held while a
+//! client reads.
+
+use std::io::Write as _;
+use std::net::SocketAddr;
+use std::os::raw::c_char;
+use std::ptr;
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+use tokio::net::{TcpListener, TcpStream};
+use tokio::sync::Semaphore;
+use tokio::task::JoinHandle;
+
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::ffi::read_cstr;
+use crate::metrics::{
+    METRIC_DESCS, METRICS, MetricDesc, MetricScope, MetricValue, SpircMetrics,
+    cspot_metrics_bucket_bound_us, spirc_metrics,
+};
+use crate::runtime::runtime;
+use crate::runtime_stats::{TaskKind, monitored};
+
+/// Longest request head the server reads; larger requests are dropped.
+const MAX_REQUEST_BYTES: usize = 8 * 1024;
+/// How long a client has to send its request head.
+const REQUEST_TIMEOUT: Duration = Duration::from_secs(10);
+/// How long a client has to read the response.
+const RESPONSE_TIMEOUT: Duration = Duration::from_secs(10);
+/// Connections served at once; further clients wait in the listen backlog.
+const MAX_CONNECTIONS: usize = 16;
+const CONTENT_TYPE: &str = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+const NOT_FOUND: &[u8] =
+    b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+const METHOD_NOT_ALLOWED: &[u8] = b"HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\n\
+    Content-Length: 0\r\nConnection: close\r\n\r\n";
+
+/// Opaque handle for a running metrics server.
+#[allow(non_camel_case_types)]
+pub struct cspot_metrics_server_t;
+
+struct MetricsServerHandle {
+    local_addr: SocketAddr,
+    task: JoinHandle<()>,
+}
+
+/// Buffers for rendering one scrape, reused across connections.
+#[derive(Default)]
+struct Scrape {
+    head: Vec<u8>,
+    body: Vec<u8>,
+    spircs: Vec<Arc<SpircMetrics>>,
+}
+
+impl Scrape {
+    fn render(&mut self) {
+        self.body.clear();
+        spirc_metrics(&mut self.spircs);
+        let process = METRICS.snapshot();
+        let body = &mut self.body;
+        for desc in METRIC_DESCS {
+            write_family_header(body, desc);
+            match desc.scope {
+                MetricScope::Process => write_samples(body, desc, (desc.read)(&process), None),
+                MetricScope::Spirc => {
+                    for spirc in &self.spircs {
+                        let snapshot = spirc.snapshot();
+                        write_samples(body, desc, (desc.read)(&snapshot), Some(spirc));
+                    }
+                }
+            }
+        }
+        body.extend_from_slice(b"# EOF\n");
+
+        self.head.clear();
+        let _ = write!(
+            self.head,
+            "HTTP/1.1 200 OK\r\nContent-Type: {CONTENT_TYPE}\r\nContent-Length: {}\r\n\
+             Connection: close\r\n\r\n",
+            self.body.len()
+        );
+    }
+}
+
+/// Scrape buffers not in use, at most one per concurrent connection.
+#[derive(Default)]
+struct ScrapePool {
+    idle: Mutex<Vec<Scrape>>,
+}
+
+impl ScrapePool {
+    fn take(&self) -> Scrape {
+        self.idle
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .pop()
+            .unwrap_or_default()
+    }
+
+    fn put(&self, scrape: Scrape) {
+        self.idle
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .push(scrape);
+    }
+}
+
+/// Writes the metric family name: `cspot_` plus the registry name, with histograms
+/// converted from microseconds to seconds as OpenMetrics expects.
+fn write_family_name(out: &mut Vec<u8>, desc: &MetricDesc) {
+    out.extend_from_slice(b"cspot_");
+    match desc.name.strip_suffix("_us") {
+        Some(base) => {
+            out.extend_from_slice(base.as_bytes());
+            out.extend_from_slice(b"_seconds");
+        }
+        None => out.extend_from_slice(desc.name.as_bytes()),
+    }
+}
+
+fn write_family_header(out: &mut Vec<u8>, desc: &MetricDesc) {
+    let kind = match (desc.read)(&Default::default()) {
+        MetricValue::Counter(_) => "counter",
+        MetricValue::Gauge(_) => "gauge",
+        MetricValue::Histogram(_) => "histogram",
+    };
+    out.extend_from_slice(b"# TYPE ");
+    write_family_name(out, desc);
+    let _ = writeln!(out, " {kind}");
+    if desc.name.ends_with("_us") {
+        out.extend_from_slice(b"# UNIT ");
+        write_family_name(out, desc);
+        out.extend_from_slice(b" seconds\n");
+    }
+    out.extend_from_slice(b"# HELP ");
+    write_family_name(out, desc);
+    let _ = writeln!(out, " {}", desc.help);
+}
+
+/// Writes a label set with the instance labels of `spirc`, if any, and `le`, if any.
+fn write_labels(out: &mut Vec<u8>, spirc: Option<&SpircMetrics>, le: Option<u64>) {
+    if spirc.is_none() && le.is_none() {
+        return;
+    }
+    out.push(b'{');
+    if let Some(spirc) = spirc {
+        let _ = write!(out, "spirc=\"{}\",device=\"", spirc.id);
+        for byte in spirc.device_name.bytes() {
+            match byte {
+                b'\\' => out.extend_from_slice(b"\\\\"),
+                b'"' => out.extend_from_slice(b"\\\""),
+                b'\n' => out.extend_from_slice(b"\\n"),
+                byte => out.push(byte),
+            }
+        }
+        out.push(b'"');
+        if le.is_some() {
+            out.push(b',');
+        }
+    }
+    match le {
+        Some(u64::MAX) => out.extend_from_slice(b"le=\"+Inf\""),
+        Some(bound_us) => {
+            let _ = write!(out, "le=\"{}\"", bound_us as f64 / 1e6);
+        }
+        None => {}
+    }
+    out.push(b'}');
+}
+
+fn write_samples(
+    out: &mut Vec<u8>,
+    desc: &MetricDesc,
+    value: MetricValue<'_>,
+    spirc: Option<&SpircMetrics>,
+) {
+    match value {
+        MetricValue::Counter(value) => {
+            write_family_name(out, desc);
+            out.extend_from_slice(b"_total");
+            write_labels(out, spirc, None);
+            let _ = writeln!(out, " {value}");
+        }
+        MetricValue::Gauge(value) => {
+            write_family_name(out, desc);
+            write_labels(out, spirc, None);
+            let _ = writeln!(out, " {value}");
+        }
+        MetricValue::Histogram(histogram) => {
+            // The count is derived from the buckets so it always matches the +Inf
+            // bucket, even if a sample was recorded while the snapshot was taken.
+            let mut cumulative = 0;
+            for (index, count) in histogram.buckets.iter().enumerate() {
+                cumulative += count;
+                write_family_name(out, desc);
+                out.extend_from_slice(b"_bucket");
+                write_labels(out, spirc, Some(cspot_metrics_bucket_bound_us(index)));
+                let _ = writeln!(out, " {cumulative}");
+            }
+            write_family_name(out, desc);
+            out.extend_from_slice(b"_sum");
+            write_labels(out, spirc, None);
+            let _ = writeln!(out, " {}", histogram.sum_us as f64 / 1e6);
+            write_family_name(out, desc);
+            out.extend_from_slice(b"_count");
+            write_labels(out, spirc, None);
+            let _ = writeln!(out, " {cumulative}");
+        }
+    }
+}
+
+/// Reads until the end of the request head and returns its length, or `None` if the
+/// client closed the connection or sent more than `MAX_REQUEST_BYTES`.
+async fn read_request_head(stream: &mut TcpStream, buf: &mut [u8]) -> Option<usize> {
+    let mut len = 0;
+    loop {
+        if buf[..len].windows(4).any(|window| window == b"\r\n\r\n") {
+            return Some(len);
+        }
+        if len == buf.len() {
+            return None;
+        }
+        match stream.read(&mut buf[len..]).await {
+            Ok(0) | Err(_) => return None,
+            Ok(read) => len += read,
+        }
+    }
+}
+
+/// Writes a fixed response, giving up after `RESPONSE_TIMEOUT`.
+async fn respond(stream: &mut TcpStream, response: &[u8]) {
+    let _ = tokio::time::timeout(RESPONSE_TIMEOUT, stream.write_all(response)).await;
+}
+
+async fn serve_connection(mut stream: TcpStream, pool: Arc<ScrapePool>) {
+    let mut buf = [0u8; MAX_REQUEST_BYTES];
+    let Ok(Some(len)) =
+        tokio::time::timeout(REQUEST_TIMEOUT, read_request_head(&mut stream, &mut buf)).await
+    else {
+        return;
+    };
+    let request_line = buf[..len]
+        .split(|byte| *byte == b'\r')
+        .next()
+        .unwrap_or_default();
+    let mut parts = request_line.split(|byte| *byte == b' ');
+    let method = parts.next().unwrap_or_default();
+    let target = parts.next().unwrap_or_default();
+    let path = target
+        .split(|byte| *byte == b'?')
+        .next()
+        .unwrap_or_default();
+
+    if path != b"/metrics" {
+        respond(&mut stream, NOT_FOUND).await;
+        return;
+    }
+    if method != b"GET" && method != b"HEAD" {
+        respond(&mut stream, METHOD_NOT_ALLOWED).await;
+        return;
+    }
+    let mut scrape = pool.take();
+    scrape.render();
+    let response = async {
+        stream.write_all(&scrape.head).await?;
+        if method == b"GET" {
+            stream.write_all(&scrape.body).await?;
+        }
+        stream.shutdown().await
+    };
+    let _ = tokio::time::timeout(RESPONSE_TIMEOUT, response).await;
+    pool.put(scrape);
+}
+
+async fn accept_loop(listener: TcpListener) {
+    let pool = Arc::new(ScrapePool::default());
+    let connections = Arc::new(Semaphore::new(MAX_CONNECTIONS));
+    loop {
+        // Waits for a free slot before accepting, so excess clients queue in the
+        // backlog instead of each holding a task and a set of buffers.
+        let Ok(permit) = Arc::clone(&connections).acquire_owned().await else {
+            return;
+        };
+        match listener.accept().await {
+            Ok((stream, _)) => {
+                let pool = Arc::clone(&pool);
+                tokio::spawn(monitored(TaskKind::MetricsServer, async move {
+                    serve_connection(stream, pool).await;
+                    drop(permit);
+                }));
+            }
+            Err(err) => {
+                log::warn!("metrics server failed to accept a connection: {err}");
+                tokio::time::sleep(Duration::from_millis(100)).await;
+            }
+        }
+    }
+}
+
+/// Starts an HTTP server on the cspot runtime that serves `GET /metrics` in the
+/// OpenMetrics text format.
+///
+/// `bind_addr` is an address and port such as `127.0.0.1:9464`; port 0 picks a free
+/// port, which `cspot_metrics_server_port` reports. Metrics that belong to a Connect
+/// instance are labelled with `spirc` (a process-unique id) and `device` (its Connect
+/// name). Up to 16 clients are served at once, and each has 10 seconds to send its
+/// request and 10 to read the response. The server does no authentication, so bind it
+/// to an address only trusted clients can reach. Returns null and writes an error if
+/// the address cannot be bound. The handle must be released with
+/// `cspot_metrics_server_free`, which stops the server.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_serve(
+    bind_addr: *const c_char,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_metrics_server_t {
+    clear_error(out_error);
+    let Some(bind_addr) = read_cstr(bind_addr, "bind_addr", out_error) else {
+        return ptr::null_mut();
+    };
+    let listener = std::net::TcpListener::bind(bind_addr.as_str())
+        .and_then(|listener| listener.set_nonblocking(true).map(|()| listener))
+        .and_then(|listener| Ok((listener.local_addr()?, listener)));
+    let (local_addr, listener) = match listener {
+        Ok(value) => value,
+        Err(err) => {
+            write_error(out_error, format!("failed to bind {bind_addr}: {err}"));
+            return ptr::null_mut();
+        }
+    };
+    let _runtime = runtime().enter();
+    let listener = match TcpListener::from_std(listener) {
+        Ok(listener) => listener,
+        Err(err) => {
+            write_error(out_error, format!("failed to listen on {bind_addr}: {err}"));
+            return ptr::null_mut();
+        }
+    };
+    let task = runtime().spawn(monitored(TaskKind::MetricsServer, accept_loop(listener)));
+    Box::into_raw(Box::new(MetricsServerHandle { local_addr, task })) as *mut cspot_metrics_server_t
+}
+
+/// Returns the port a metrics server is listening on, or 0 if `server` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_server_port(server: *const cspot_metrics_server_t) -> u16 {
+    if server.is_null() {
+        return 0;
+    }
+    // Safety: server must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(server as *const MetricsServerHandle) };
+    handle.local_addr.port()
+}
+
+/// Stops a metrics server and releases its handle.
+///
+/// Scrapes already being answered may still complete.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_metrics_server_free(server: *mut cspot_metrics_server_t) {
+    if server.is_null() {
+        return;
+    }
+    // Safety: server must be a valid handle allocated by cspot.
+    let handle = unsafe { Box::from_raw(server as *mut MetricsServerHandle) };
+    handle.task.abort();
+}
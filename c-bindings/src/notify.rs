@@ -0,0 +1,150 @@
+//! Pollable readiness descriptors for hosts with their own event loop.
+
+use std::os::raw::c_int;
+use std::sync::atomic::{AtomicBool, Ordering};
+
+/// Level-style readiness signal backed by an eventfd (Linux/Android) or a pipe
+/// (other unix platforms).
+///
+/// The descriptor becomes readable after `notify` and stays readable until `clear`.
+/// Only the first `notify` after a `clear` touches the descriptor, so signalling an
+/// already-ready notifier costs a single atomic operation; `clear` always drains it.
+/// On platforms without file descriptors the notifier is inert and `fd` returns -1.
+pub(crate) struct Notifier {
+    read_fd: c_int,
+    write_fd: c_int,
+    pending: AtomicBool,
+}
+
+impl Notifier {
+    /// Creates a notifier. If the descriptor cannot be created, the notifier is inert.
+    pub(crate) fn new() -> Self {
+        let (read_fd, write_fd) = open_fds().unwrap_or_else(|err| {
+            log::warn!("failed to create readiness descriptor: {err}");
+            (-1, -1)
+        });
+        Self {
+            read_fd,
+            write_fd,
+            pending: AtomicBool::new(false),
+        }
+    }
+
+    /// Returns the descriptor to register for read readiness, or -1 if unavailable.
+    pub(crate) fn fd(&self) -> c_int {
+        self.read_fd
+    }
+
+    /// Marks the notifier ready.
+    pub(crate) fn notify(&self) {
+        if !self.pending.swap(true, Ordering::AcqRel) {
+            signal_fd(self.write_fd);
+        }
+    }
+
+    /// Marks the notifier idle.
+    ///
+    /// Callers must clear before consuming the state the notifier guards, and must
+    /// re-check that state after `clear` returns: a `notify` racing with `clear` may
+    /// leave the descriptor unreadable, but its state is then seen by that check.
+    pub(crate) fn clear(&self) {
+        // Drain before resetting `pending`, so a `notify` that lands in between either
+        // sees `pending` still set, and its state is found by the caller's re-check,
+        // or writes after the drain and leaves the descriptor readable. Draining the
+        // other way round could eat a write made after the reset and leave `pending`
+        // set with an empty descriptor, silencing every later `notify`.
+        drain_fd(self.read_fd);
+        self.pending.store(false, Ordering::Release);
+    }
+}
+
+impl Drop for Notifier {
+    fn drop(&mut self) {
+        close_fds(self.read_fd, self.write_fd);
+    }
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn open_fds() -> std::io::Result<(c_int, c_int)> {
+    // Safety: eventfd has no pointer arguments.
+    let fd = unsafe { libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC) };
+    if fd < 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    Ok((fd, fd))
+}
+
+#[cfg(all(unix, not(any(target_os = "linux", target_os = "android"))))]
+fn open_fds() -> std::io::Result<(c_int, c_int)> {
+    let mut fds = [-1 as c_int; 2];
+    // Safety: fds points to two writable descriptors as pipe requires.
+    if unsafe { libc::pipe(fds.as_mut_ptr()) } != 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    for fd in fds {
+        // Safety: fd was just returned by pipe and is owned by this function.
+        let ok = unsafe {
+            let flags = libc::fcntl(fd, libc::F_GETFL);
+            libc::fcntl(fd, libc::F_SETFL, flags | libc::O_NONBLOCK) == 0
+                && libc::fcntl(fd, libc::F_SETFD, libc::FD_CLOEXEC) == 0
+        };
+        if !ok {
+            let err = std::io::Error::last_os_error();
+            close_fds(fds[0], fds[1]);
+            return Err(err);
+        }
+    }
+    Ok((fds[0], fds[1]))
+}
+
+#[cfg(not(unix))]
+fn open_fds() -> std::io::Result<(c_int, c_int)> {
+    Ok((-1, -1))
+}
+
+#[cfg(unix)]
+fn signal_fd(fd: c_int) {
+    if fd < 0 {
+        return;
+    }
+    // An eventfd needs an 8-byte counter increment; a pipe accepts any byte count.
+    let value: u64 = 1;
+    // Safety: value is a live 8-byte buffer. A full pipe or saturated counter
+    // (EAGAIN) already means "readable", so the result is ignored.
+    unsafe {
+        libc::write(fd, &value as *const u64 as *const libc::c_void, 8);
+    }
+}
+
+#[cfg(not(unix))]
+fn signal_fd(_fd: c_int) {}
+
+#[cfg(unix)]
+fn drain_fd(fd: c_int) {
+    if fd < 0 {
+        return;
+    }
+    let mut buf = [0u8; 64];
+    // Safety: buf is a live writable buffer of the given length. The descriptor is
+    // non-blocking, so the loop ends once it is empty.
+    while unsafe { libc::read(fd, buf.as_mut_ptr() as *mut libc::c_void, buf.len()) } > 0 {}
+}
+
+#[cfg(not(unix))]
+fn drain_fd(_fd: c_int) {}
+
+#[cfg(unix)]
+fn close_fds(read_fd: c_int, write_fd: c_int) {
+    // Safety: the descriptors are owned by the notifier and closed exactly once.
+    unsafe {
+        if read_fd >= 0 {
+            libc::close(read_fd);
+        }
+        if write_fd >= 0 && write_fd != read_fd {
+            libc::close(write_fd);
+        }
+    }
+}
+
+#[cfg(not(unix))]
+fn close_fds(_read_fd: c_int, _write_fd: c_int) {}
@@ -0,0 +1,230 @@
+//! Pull-model PCM output for hosts with real-time audio callbacks.
+
+use std::ptr;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+use librespot::playback::SAMPLE_RATE;
+use librespot::playback::audio_backend::{Sink, SinkResult};
+use librespot::playback::config::AudioFormat;
+use librespot::playback::convert::Converter;
+use librespot::playback::decoder::AudioPacket;
+use librespot::playback::dither::DithererBuilder;
+
+use crate::convert::PcmConverter;
+use crate::metrics::{METRICS, PacketTimer};
+use crate::ring::SpscRing;
+use crate::sink::{frame_bytes, write_packet};
+use crate::trace;
+
+/// Ring size used when the caller asks for 0 frames (about 93 ms at 44.1 kHz).
+const DEFAULT_RING_FRAMES: usize = 4096;
+
+/// How long the player waits for ring space before dropping audio.
+const OVERRUN_TIMEOUT: Duration = Duration::from_secs(1);
+
+/// PCM counters reported by `cspot_pcm_stats`.
+///
+/// Underruns are only counted while the player is playing, so reads during pauses
+/// and between tracks do not inflate them.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_pcm_stats_t {
+    /// Reads that found fewer frames than requested.
+    pub underruns: u64,
+    /// Frames filled with silence because the ring was empty.
+    pub underrun_frames: u64,
+    /// Writes that timed out waiting for ring space.
+    pub overruns: u64,
+    /// Frames dropped because the ring stayed full.
+    pub overrun_frames: u64,
+    /// Frames waiting to be read.
+    pub buffered_frames: usize,
+    /// Total ring capacity in frames.
+    pub capacity_frames: usize,
+}
+
+/// Ring of interleaved frames shared between a player's sink and the host's reader.
+///
+/// The player's audio thread is the only producer and only ever pushes whole frames;
+/// the host's audio callback is the only consumer.
+pub(crate) struct PcmRing {
+    ring: SpscRing<u8>,
+    frame_bytes: usize,
+    playing: AtomicBool,
+    reading: AtomicBool,
+    underruns: AtomicU64,
+    underrun_frames: AtomicU64,
+    overruns: AtomicU64,
+    overrun_frames: AtomicU64,
+}
+
+impl PcmRing {
+    pub(crate) fn new(format: AudioFormat, capacity_frames: usize) -> Self {
+        let frame_bytes = frame_bytes(format);
+        let capacity_frames = if capacity_frames == 0 {
+            DEFAULT_RING_FRAMES
+        } else {
+            capacity_frames
+        };
+        Self {
+            ring: SpscRing::with_capacity(capacity_frames.saturating_mul(frame_bytes)),
+            frame_bytes,
+            playing: AtomicBool::new(false),
+            reading: AtomicBool::new(false),
+            underruns: AtomicU64::new(0),
+            underrun_frames: AtomicU64::new(0),
+            overruns: AtomicU64::new(0),
+            overrun_frames: AtomicU64::new(0),
+        }
+    }
+
+    fn capacity_frames(&self) -> usize {
+        self.ring.capacity() / self.frame_bytes
+    }
+
+    /// Duration of audio the ring can hold.
+    fn capacity_duration(&self) -> Duration {
+        Duration::from_micros(self.capacity_frames() as u64 * 1_000_000 / SAMPLE_RATE as u64)
+    }
+
+    /// Copies up to `frames` frames into `dst` and fills the rest with silence.
+    ///
+    /// Never blocks, allocates or makes system calls. Returns the number of frames that
+    /// came from the ring. A read that overlaps another read of the same ring returns
+    /// silence.
+    ///
+    /// # Safety
+    ///
+    /// `dst` must be valid for writes of `frames` frames.
+    pub(crate) unsafe fn read(&self, dst: *mut u8, frames: usize) -> usize {
+        let wanted = frames.saturating_mul(self.frame_bytes);
+        let mut read = 0;
+        if self
+            .reading
+            .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_ok()
+        {
+            let available = self.ring.len() / self.frame_bytes * self.frame_bytes;
+            // Safety: the reading flag makes this the only consumer; dst is writable
+            // for `wanted` bytes.
+            read = unsafe { self.ring.pop_into(dst, wanted.min(available)) };
+            self.reading.store(false, Ordering::Release);
+        }
+        if read < wanted {
+            // Safety: dst is writable for `wanted` bytes. Zero bytes are silence in
+            // every supported format.
+            unsafe { ptr::write_bytes(dst.add(read), 0, wanted - read) };
+            if self.playing.load(Ordering::Relaxed) {
+                let frames = ((wanted - read) / self.frame_bytes) as u64;
+                self.underruns.fetch_add(1, Ordering::Relaxed);
+                self.underrun_frames.fetch_add(frames, Ordering::Relaxed);
+                METRICS.underruns.inc();
+                METRICS.underrun_frames.add(frames);
+            }
+        }
+        read / self.frame_bytes
+    }
+
+    pub(crate) fn stats(&self) -> cspot_pcm_stats_t {
+        cspot_pcm_stats_t {
+            underruns: self.underruns.load(Ordering::Relaxed),
+            underrun_frames: self.underrun_frames.load(Ordering::Relaxed),
+            overruns: self.overruns.load(Ordering::Relaxed),
+            overrun_frames: self.overrun_frames.load(Ordering::Relaxed),
+            buffered_frames: self.ring.len() / self.frame_bytes,
+            capacity_frames: self.capacity_frames(),
+        }
+    }
+}
+
+/// Sink that writes converted PCM into a `PcmRing`.
+///
+/// When the ring is full the sink sleeps in short steps until the reader makes room,
+/// so playback is paced by the host's audio callback. If the reader stops for longer
+/// than `OVERRUN_TIMEOUT`, audio is dropped until it resumes; each dropped packet still
+/// takes as long to write as it would take to play, so the track keeps its real-time
+/// pace instead of decoding to the end at full speed.
+pub(crate) struct RingSink {
+    ring: Arc<PcmRing>,
+    format: AudioFormat,
+    converter: PcmConverter,
+    stalled: bool,
+    timer: PacketTimer,
+}
+
+impl RingSink {
+    pub(crate) fn new(
+        ring: Arc<PcmRing>,
+        format: AudioFormat,
+        ditherer: Option<DithererBuilder>,
+    ) -> Self {
+        Self {
+            ring,
+            format,
+            converter: PcmConverter::new(ditherer),
+            stalled: false,
+            timer: PacketTimer::default(),
+        }
+    }
+}
+
+/// Pushes whole frames into `ring`, waiting for space as described on `RingSink`.
+fn push_frames(ring: &PcmRing, stalled: &mut bool, mut frames: &[u8]) {
+    let frame_bytes = ring.frame_bytes;
+    let poll_interval =
+        (ring.capacity_duration() / 4).clamp(Duration::from_millis(1), Duration::from_millis(20));
+    let deadline = Instant::now() + OVERRUN_TIMEOUT;
+    while !frames.is_empty() {
+        let free = ring.ring.capacity() - ring.ring.len();
+        let count = (free / frame_bytes * frame_bytes).min(frames.len());
+        if count > 0 {
+            // Safety: the player's audio thread is the ring's only producer.
+            let pushed = unsafe { ring.ring.push_slice(&frames[..count]) };
+            frames = &frames[pushed..];
+            *stalled = false;
+            continue;
+        }
+        if *stalled || Instant::now() >= deadline {
+            *stalled = true;
+            ring.overruns.fetch_add(1, Ordering::Relaxed);
+            METRICS.overruns.inc();
+            let dropped = (frames.len() / frame_bytes) as u64;
+            ring.overrun_frames.fetch_add(dropped, Ordering::Relaxed);
+            std::thread::sleep(Duration::from_micros(
+                dropped * 1_000_000 / SAMPLE_RATE as u64,
+            ));
+            return;
+        }
+        std::thread::sleep(poll_interval);
+    }
+}
+
+impl Sink for RingSink {
+    fn start(&mut self) -> SinkResult<()> {
+        trace::instant("playback", "sink.start");
+        self.timer.reset();
+        self.ring.playing.store(true, Ordering::Relaxed);
+        Ok(())
+    }
+
+    fn stop(&mut self) -> SinkResult<()> {
+        trace::instant("playback", "sink.stop");
+        self.timer.reset();
+        self.ring.playing.store(false, Ordering::Relaxed);
+        Ok(())
+    }
+
+    fn write(&mut self, packet: AudioPacket, _converter: &mut Converter) -> SinkResult<()> {
+        let (ring, stalled, converter) = (&self.ring, &mut self.stalled, &mut self.converter);
+        let format = self.format;
+        self.timer.time_write(|| {
+            write_packet(format, &packet, converter, |frames| {
+                push_frames(ring, stalled, frames);
+                Ok(())
+            })
+        })
+    }
+}
@@ -1,18 +1,30 @@
 //! C bindings for librespot playback components.
 
+use std::ffi::CString;
+use std::os::raw::{c_char, c_void};
 use std::panic::AssertUnwindSafe;
 use std::ptr;
 use std::sync::Arc;
+use std::time::Duration;
 
 use librespot::playback::{
-    audio_backend,
-    config::{AudioFormat, PlayerConfig},
+    audio_backend::{self, Sink},
+    config::{AudioFormat, Bitrate, NormalisationMethod, NormalisationType, PlayerConfig},
+    dither::{self, DithererBuilder},
     mixer::{self, Mixer, MixerConfig},
-    player::Player,
+    player::{Player, duration_to_coefficient},
 };
 
+use once_cell::sync::Lazy;
+
+use crate::cache::watch_player;
 use crate::error::{clear_error, cspot_error_t, write_error};
-use crate::session::session_from_handle;
+use crate::ffi::read_optional_cstr;
+use crate::pcm::{PcmRing, RingSink, cspot_pcm_stats_t};
+use crate::session::{cache_stats_from_handle, session_from_handle};
+use crate::sink::{
+    CallbackSink, SinkCallbacks, TimedSink, cspot_audio_format_t, cspot_sink_callbacks_t,
+};
 
 /// Opaque mixer handle for C callers.
 #[allow(non_camel_case_types)]
@@ -22,12 +34,88 @@ pub struct cspot_mixer_t;
 #[allow(non_camel_case_types)]
 pub struct cspot_player_t;
 
+/// Opaque player configuration handle for C callers.
+#[allow(non_camel_case_types)]
+pub struct cspot_player_config_t;
+
+/// Audio bitrates exposed to C callers, in kbps.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_bitrate_t {
+    CSPOT_BITRATE_96 = 0,
+    CSPOT_BITRATE_160 = 1,
+    CSPOT_BITRATE_320 = 2,
+}
+
+impl From<cspot_bitrate_t> for Bitrate {
+    fn from(value: cspot_bitrate_t) -> Self {
+        match value {
+            cspot_bitrate_t::CSPOT_BITRATE_96 => Bitrate::Bitrate96,
+            cspot_bitrate_t::CSPOT_BITRATE_160 => Bitrate::Bitrate160,
+            cspot_bitrate_t::CSPOT_BITRATE_320 => Bitrate::Bitrate320,
+        }
+    }
+}
+
+/// Which loudness value normalisation follows.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_normalisation_type_t {
+    /// Album gain when playing an album in order, track gain otherwise.
+    CSPOT_NORMALISATION_TYPE_AUTO = 0,
+    CSPOT_NORMALISATION_TYPE_ALBUM = 1,
+    CSPOT_NORMALISATION_TYPE_TRACK = 2,
+}
+
+impl From<cspot_normalisation_type_t> for NormalisationType {
+    fn from(value: cspot_normalisation_type_t) -> Self {
+        match value {
+            cspot_normalisation_type_t::CSPOT_NORMALISATION_TYPE_AUTO => NormalisationType::Auto,
+            cspot_normalisation_type_t::CSPOT_NORMALISATION_TYPE_ALBUM => NormalisationType::Album,
+            cspot_normalisation_type_t::CSPOT_NORMALISATION_TYPE_TRACK => NormalisationType::Track,
+        }
+    }
+}
+
+/// How normalisation applies gain.
+///
+/// `BASIC` applies a fixed gain per track. `DYNAMIC` adds a limiter shaped by the
+/// threshold, attack, release and knee settings, at a higher CPU cost.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_normalisation_method_t {
+    CSPOT_NORMALISATION_METHOD_BASIC = 0,
+    CSPOT_NORMALISATION_METHOD_DYNAMIC = 1,
+}
+
+impl From<cspot_normalisation_method_t> for NormalisationMethod {
+    fn from(value: cspot_normalisation_method_t) -> Self {
+        match value {
+            cspot_normalisation_method_t::CSPOT_NORMALISATION_METHOD_BASIC => {
+                NormalisationMethod::Basic
+            }
+            cspot_normalisation_method_t::CSPOT_NORMALISATION_METHOD_DYNAMIC => {
+                NormalisationMethod::Dynamic
+            }
+        }
+    }
+}
+
 struct MixerHandle {
     mixer: Arc<dyn Mixer>,
 }
 
+struct PlayerConfigHandle {
+    config: PlayerConfig,
+    output: PlayerOutput,
+}
+
 struct PlayerHandle {
     player: Arc<Player>,
+    pcm: Option<Arc<PcmRing>>,
 }
 
 /// Creates a mixer using the default mixer backend and default configuration.
@@ -56,16 +144,90 @@ pub extern "C" fn cspot_mixer_create_default(
     }
 }
 
-/// Creates a player using default configuration and the default audio backend.
+/// Where a player sends decoded audio.
+#[derive(Clone)]
+enum PlayerOutput {
+    Backend {
+        name: Option<String>,
+        device: Option<String>,
+        format: AudioFormat,
+    },
+    Sink {
+        callbacks: SinkCallbacks,
+        format: AudioFormat,
+    },
+    Ring {
+        format: AudioFormat,
+        capacity_frames: usize,
+    },
+}
+
+impl Default for PlayerOutput {
+    fn default() -> Self {
+        Self::Backend {
+            name: None,
+            device: None,
+            format: AudioFormat::default(),
+        }
+    }
+}
+
+type SinkBuilderFn = Box<dyn FnOnce() -> Box<dyn Sink> + Send>;
+
+impl PlayerOutput {
+    /// Resolves the output into a sink builder for the player's audio thread, plus the
+    /// PCM ring when the host pulls audio itself.
+    fn into_sink_builder(
+        self,
+        ditherer: Option<DithererBuilder>,
+    ) -> Result<(SinkBuilderFn, Option<Arc<PcmRing>>), String> {
+        match self {
+            Self::Backend {
+                name,
+                device,
+                format,
+            } => {
+                let backend = match name {
+                    Some(name) => audio_backend::find(Some(name.clone()))
+                        .ok_or_else(|| format!("unknown audio backend: {name}"))?,
+                    None => audio_backend::find(None)
+                        .ok_or_else(|| "no audio backend available".to_string())?,
+                };
+                Ok((
+                    Box::new(move || Box::new(TimedSink::new(backend(device, format)))),
+                    None,
+                ))
+            }
+            Self::Sink { callbacks, format } => Ok((
+                Box::new(move || Box::new(CallbackSink::new(callbacks, format, ditherer))),
+                None,
+            )),
+            Self::Ring {
+                format,
+                capacity_frames,
+            } => {
+                let pcm = Arc::new(PcmRing::new(format, capacity_frames));
+                let sink_ring = Arc::clone(&pcm);
+                Ok((
+                    Box::new(move || Box::new(RingSink::new(sink_ring, format, ditherer))),
+                    Some(pcm),
+                ))
+            }
+        }
+    }
+}
+
+/// Builds a player from validated session and mixer handles.
 ///
-/// The returned handle must be released with `cspot_player_free`.
-#[unsafe(no_mangle)]
-pub extern "C" fn cspot_player_create_default(
+/// The output's sink is opened on the player's audio thread once playback starts.
+fn create_player(
     session: *const crate::session::cspot_session_t,
     mixer: *const cspot_mixer_t,
+    player_config: PlayerConfig,
+    output: PlayerOutput,
     out_error: *mut *mut cspot_error_t,
 ) -> *mut cspot_player_t {
-    clear_error(out_error);
+    let cache_stats = cache_stats_from_handle(session);
     let session = match session_from_handle(session) {
         Some(value) => value,
         None => {
@@ -73,28 +235,26 @@ pub extern "C" fn cspot_player_create_default(
             return ptr::null_mut();
         }
     };
-    if mixer.is_null() {
-        write_error(out_error, "mixer handle was null");
-        return ptr::null_mut();
-    }
+    let mixer = match mixer_from_handle(mixer) {
+        Some(value) => value,
+        None => {
+            write_error(out_error, "mixer handle was null");
+            return ptr::null_mut();
+        }
+    };
 
-    // Safety: mixer must be a valid handle allocated by cspot.
-    let mixer_handle = unsafe { &*(mixer as *const MixerHandle) };
-    let mixer = Arc::clone(&mixer_handle.mixer);
-
-    let result = std::panic::catch_unwind(AssertUnwindSafe(|| -> Result<Arc<Player>, String> {
-        let backend = audio_backend::find(None)
-            .ok_or_else(|| "no audio backend available".to_string())?;
-        let player_config = PlayerConfig::default();
-        let audio_format = AudioFormat::default();
+    let result = std::panic::catch_unwind(AssertUnwindSafe(|| -> Result<PlayerHandle, String> {
+        let (sink_builder, pcm) = output.into_sink_builder(player_config.ditherer)?;
         let soft_volume = mixer.get_soft_volume();
-        Ok(Player::new(player_config, session, soft_volume, move || {
-            backend(None, audio_format)
-        }))
+        let player = Player::new(player_config, session.clone(), soft_volume, sink_builder);
+        if let Some(stats) = cache_stats {
+            watch_player(stats, &session, &player);
+        }
+        Ok(PlayerHandle { player, pcm })
     }));
 
     match result {
-        Ok(Ok(player)) => Box::into_raw(Box::new(PlayerHandle { player })) as *mut cspot_player_t,
+        Ok(Ok(handle)) => Box::into_raw(Box::new(handle)) as *mut cspot_player_t,
         Ok(Err(err)) => {
             write_error(out_error, err);
             ptr::null_mut()
@@ -106,6 +266,505 @@ pub extern "C" fn cspot_player_create_default(
     }
 }
 
+/// Creates a player using default configuration and the default audio backend.
+///
+/// The returned handle must be released with `cspot_player_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_create_default(
+    session: *const crate::session::cspot_session_t,
+    mixer: *const cspot_mixer_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_player_t {
+    clear_error(out_error);
+    create_player(
+        session,
+        mixer,
+        PlayerConfig::default(),
+        PlayerOutput::default(),
+        out_error,
+    )
+}
+
+/// Creates a player from a player configuration.
+///
+/// The configuration is copied and may be freed or reused afterwards. The returned
+/// handle must be released with `cspot_player_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_create_with_config(
+    session: *const crate::session::cspot_session_t,
+    mixer: *const cspot_mixer_t,
+    config: *const cspot_player_config_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_player_t {
+    clear_error(out_error);
+    if config.is_null() {
+        write_error(out_error, "config handle was null");
+        return ptr::null_mut();
+    }
+    // Safety: config must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(config as *const PlayerConfigHandle) };
+    create_player(
+        session,
+        mixer,
+        handle.config.clone(),
+        handle.output.clone(),
+        out_error,
+    )
+}
+
+/// Names of the audio backends compiled into librespot, in preference order.
+static BACKEND_NAMES: Lazy<Vec<CString>> = Lazy::new(|| {
+    audio_backend::BACKENDS
+        .iter()
+        .map(|(name, _)| CString::new(*name).unwrap_or_default())
+        .collect()
+});
+
+/// Returns the number of audio backends available to `cspot_player_create_with_backend`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_audio_backend_count() -> usize {
+    BACKEND_NAMES.len()
+}
+
+/// Returns the name of the audio backend at `index`, or null if out of range.
+///
+/// The string is owned by cspot and stays valid for the lifetime of the process.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_audio_backend_name(index: usize) -> *const c_char {
+    BACKEND_NAMES
+        .get(index)
+        .map_or(ptr::null(), |name| name.as_ptr())
+}
+
+/// Creates a player that writes to a named audio backend and device in `format`.
+///
+/// `backend` selects one of the names reported by `cspot_audio_backend_name`; null
+/// selects the default backend. `device` is passed to the backend as-is; null selects
+/// its default device. Backends reject formats they cannot play when playback starts.
+/// The returned handle must be released with `cspot_player_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_create_with_backend(
+    session: *const crate::session::cspot_session_t,
+    mixer: *const cspot_mixer_t,
+    backend: *const c_char,
+    device: *const c_char,
+    format: cspot_audio_format_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_player_t {
+    clear_error(out_error);
+    let output = PlayerOutput::Backend {
+        name: read_optional_cstr(backend),
+        device: read_optional_cstr(device),
+        format: format.into(),
+    };
+    create_player(session, mixer, PlayerConfig::default(), output, out_error)
+}
+
+/// Creates a player that delivers decoded audio to C callbacks instead of an audio backend.
+///
+/// `callbacks` is copied; its `write` callback is required. Audio is delivered in
+/// `format` as described for `cspot_sink_callbacks_t`. The returned handle must be
+/// released with `cspot_player_free`, and `user_data` must stay valid until then.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_create_with_sink(
+    session: *const crate::session::cspot_session_t,
+    mixer: *const cspot_mixer_t,
+    callbacks: *const cspot_sink_callbacks_t,
+    format: cspot_audio_format_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_player_t {
+    clear_error(out_error);
+    let output = match sink_output(callbacks, format) {
+        Ok(value) => value,
+        Err(err) => {
+            write_error(out_error, err);
+            return ptr::null_mut();
+        }
+    };
+    create_player(session, mixer, PlayerConfig::default(), output, out_error)
+}
+
+/// Creates a player that buffers decoded audio for the host to pull with `cspot_pcm_read`.
+///
+/// Audio is stereo at 44.1 kHz, interleaved, in `format`. The ring holds at least
+/// `capacity_frames` frames, rounded up; pass 0 for the default of 4096. The player
+/// waits while the ring is full, so playback is paced by how fast the host reads. If the
+/// host stops reading for more than a second, audio is dropped in real time until it
+/// resumes, so the track position keeps advancing at normal speed. The returned handle
+/// must be released with `cspot_player_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_create_with_ring(
+    session: *const crate::session::cspot_session_t,
+    mixer: *const cspot_mixer_t,
+    format: cspot_audio_format_t,
+    capacity_frames: usize,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_player_t {
+    clear_error(out_error);
+    let output = PlayerOutput::Ring {
+        format: format.into(),
+        capacity_frames,
+    };
+    create_player(session, mixer, PlayerConfig::default(), output, out_error)
+}
+
+fn sink_output(
+    callbacks: *const cspot_sink_callbacks_t,
+    format: cspot_audio_format_t,
+) -> Result<PlayerOutput, String> {
+    if callbacks.is_null() {
+        return Err("sink callbacks were null".to_string());
+    }
+    // Safety: callbacks must point to a valid cspot_sink_callbacks_t.
+    let callbacks = SinkCallbacks::new(unsafe { &*callbacks })
+        .ok_or_else(|| "sink write callback was null".to_string())?;
+    Ok(PlayerOutput::Sink {
+        callbacks,
+        format: format.into(),
+    })
+}
+
+/// Creates a player configuration using librespot's defaults and the default audio backend.
+///
+/// The returned handle must be released with `cspot_player_config_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_create_default() -> *mut cspot_player_config_t {
+    let handle = PlayerConfigHandle {
+        config: PlayerConfig::default(),
+        output: PlayerOutput::default(),
+    };
+    Box::into_raw(Box::new(handle)) as *mut cspot_player_config_t
+}
+
+/// Applies `update` to a player configuration, writing any error it returns.
+fn update_player_config(
+    config: *mut cspot_player_config_t,
+    out_error: *mut *mut cspot_error_t,
+    update: impl FnOnce(&mut PlayerConfigHandle) -> Result<(), String>,
+) -> bool {
+    clear_error(out_error);
+    if config.is_null() {
+        write_error(out_error, "config handle was null");
+        return false;
+    }
+    // Safety: config must be a valid handle allocated by cspot.
+    let handle = unsafe { &mut *(config as *mut PlayerConfigHandle) };
+    match update(handle) {
+        Ok(()) => true,
+        Err(err) => {
+            write_error(out_error, err);
+            false
+        }
+    }
+}
+
+fn check_range(field: &str, value: f64, min: f64, max: f64) -> Result<f64, String> {
+    if (min..=max).contains(&value) {
+        Ok(value)
+    } else {
+        Err(format!("{field} must be between {min} and {max}"))
+    }
+}
+
+/// Sets the bitrate requested for new tracks.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_bitrate(
+    config: *mut cspot_player_config_t,
+    bitrate: cspot_bitrate_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.bitrate = bitrate.into();
+        Ok(())
+    })
+}
+
+/// Sets whether consecutive tracks play without a gap.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_gapless(
+    config: *mut cspot_player_config_t,
+    gapless: bool,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.gapless = gapless;
+        Ok(())
+    })
+}
+
+/// Sets whether encoded audio is passed to the sink without decoding.
+///
+/// Only librespot backends that accept raw Ogg packets support pass-through; cspot's
+/// callback and ring outputs do not.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_passthrough(
+    config: *mut cspot_player_config_t,
+    passthrough: bool,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.passthrough = passthrough;
+        Ok(())
+    })
+}
+
+/// Enables or disables volume normalisation.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation(
+    config: *mut cspot_player_config_t,
+    enabled: bool,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation = enabled;
+        Ok(())
+    })
+}
+
+/// Sets which loudness value normalisation follows.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_type(
+    config: *mut cspot_player_config_t,
+    normalisation_type: cspot_normalisation_type_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation_type = normalisation_type.into();
+        Ok(())
+    })
+}
+
+/// Sets how normalisation applies gain.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_method(
+    config: *mut cspot_player_config_t,
+    method: cspot_normalisation_method_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation_method = method.into();
+        Ok(())
+    })
+}
+
+/// Sets the normalisation pregain in dB, from -10 to 10.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_pregain(
+    config: *mut cspot_player_config_t,
+    pregain_db: f64,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation_pregain_db = check_range("pregain", pregain_db, -10.0, 10.0)?;
+        Ok(())
+    })
+}
+
+/// Sets the dynamic limiter threshold in dBFS, from -10 to 0.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_threshold(
+    config: *mut cspot_player_config_t,
+    threshold_dbfs: f64,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation_threshold_dbfs =
+            check_range("threshold", threshold_dbfs, -10.0, 0.0)?;
+        Ok(())
+    })
+}
+
+/// Sets the dynamic limiter attack time in milliseconds, from 1 to 500.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_attack(
+    config: *mut cspot_player_config_t,
+    attack_ms: u32,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        let attack_ms = check_range("attack", attack_ms.into(), 1.0, 500.0)?;
+        handle.config.normalisation_attack_cf =
+            duration_to_coefficient(Duration::from_secs_f64(attack_ms / 1000.0));
+        Ok(())
+    })
+}
+
+/// Sets the dynamic limiter release time in milliseconds, from 1 to 1000.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_release(
+    config: *mut cspot_player_config_t,
+    release_ms: u32,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        let release_ms = check_range("release", release_ms.into(), 1.0, 1000.0)?;
+        handle.config.normalisation_release_cf =
+            duration_to_coefficient(Duration::from_secs_f64(release_ms / 1000.0));
+        Ok(())
+    })
+}
+
+/// Sets the dynamic limiter knee width in dB, from 0 to 10.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_normalisation_knee(
+    config: *mut cspot_player_config_t,
+    knee_db: f64,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.config.normalisation_knee_db = check_range("knee", knee_db, 0.0, 10.0)?;
+        Ok(())
+    })
+}
+
+/// Selects the ditherer applied when converting to integer formats.
+///
+/// `name` is one of librespot's ditherers ("tpdf", "tpdf_hp" or "gpdf"); null disables
+/// dithering. "tpdf", the default, is the cheapest on cspot's callback and ring outputs.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_ditherer(
+    config: *mut cspot_player_config_t,
+    name: *const c_char,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    let name = read_optional_cstr(name);
+    update_player_config(config, out_error, |handle| {
+        handle.config.ditherer = match name {
+            Some(name) => Some(
+                dither::find_ditherer(Some(name.clone()))
+                    .ok_or_else(|| format!("unknown ditherer: {name}"))?,
+            ),
+            None => None,
+        };
+        Ok(())
+    })
+}
+
+/// Sends audio to a named audio backend and device, as for
+/// `cspot_player_create_with_backend`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_output_backend(
+    config: *mut cspot_player_config_t,
+    backend: *const c_char,
+    device: *const c_char,
+    format: cspot_audio_format_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    let output = PlayerOutput::Backend {
+        name: read_optional_cstr(backend),
+        device: read_optional_cstr(device),
+        format: format.into(),
+    };
+    update_player_config(config, out_error, |handle| {
+        handle.output = output;
+        Ok(())
+    })
+}
+
+/// Sends audio to C callbacks, as for `cspot_player_create_with_sink`.
+///
+/// `user_data` must stay valid until every player created from this configuration has
+/// been freed.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_output_sink(
+    config: *mut cspot_player_config_t,
+    callbacks: *const cspot_sink_callbacks_t,
+    format: cspot_audio_format_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.output = sink_output(callbacks, format)?;
+        Ok(())
+    })
+}
+
+/// Buffers audio for `cspot_pcm_read`, as for `cspot_player_create_with_ring`.
+///
+/// Each player created from this configuration gets its own ring.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_set_output_ring(
+    config: *mut cspot_player_config_t,
+    format: cspot_audio_format_t,
+    capacity_frames: usize,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    update_player_config(config, out_error, |handle| {
+        handle.output = PlayerOutput::Ring {
+            format: format.into(),
+            capacity_frames,
+        };
+        Ok(())
+    })
+}
+
+/// Frees a player configuration handle.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_player_config_free(config: *mut cspot_player_config_t) {
+    if config.is_null() {
+        return;
+    }
+    // Safety: config must be a valid handle allocated by cspot.
+    unsafe {
+        drop(Box::from_raw(config as *mut PlayerConfigHandle));
+    }
+}
+
+/// Copies `frames` frames of buffered audio into `dst`, filling any shortfall with silence.
+///
+/// Returns the number of frames that came from the player; the rest of `dst` is zeroed
+/// and counted as an underrun while playing. This call never blocks, allocates or
+/// makes system calls, so it is safe to use from a real-time audio callback. Only one
+/// thread should read a given player. Returns 0 without touching `dst` if the player
+/// was not created with `cspot_player_create_with_ring`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_pcm_read(
+    player: *const cspot_player_t,
+    dst: *mut c_void,
+    frames: usize,
+) -> usize {
+    if player.is_null() || dst.is_null() {
+        return 0;
+    }
+    // Safety: player must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(player as *const PlayerHandle) };
+    match handle.pcm.as_ref() {
+        // Safety: the caller guarantees dst holds `frames` frames in the player's format.
+        Some(pcm) => unsafe { pcm.read(dst as *mut u8, frames) },
+        None => 0,
+    }
+}
+
+/// Reads the PCM ring counters of a player created with `cspot_player_create_with_ring`.
+///
+/// Returns false and writes an error if the player has no PCM ring.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_pcm_stats(
+    player: *const cspot_player_t,
+    out_stats: *mut cspot_pcm_stats_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    if player.is_null() {
+        write_error(out_error, "player handle was null");
+        return false;
+    }
+    if out_stats.is_null() {
+        write_error(out_error, "out_stats was null");
+        return false;
+    }
+    // Safety: player must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(player as *const PlayerHandle) };
+    let Some(pcm) = handle.pcm.as_ref() else {
+        write_error(out_error, "player was not created with a PCM ring");
+        return false;
+    };
+    // Safety: out_stats is non-null and points to writable memory.
+    unsafe {
+        *out_stats = pcm.stats();
+    }
+    true
+}
+
 /// Frees a mixer handle.
 #[unsafe(no_mangle)]
 pub extern "C" fn cspot_mixer_free(mixer: *mut cspot_mixer_t) {
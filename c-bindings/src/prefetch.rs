@@ -0,0 +1,775 @@
+//! Background prefetching of audio files into a session's cache.
+//!
+//! A prefetch downloads the encrypted audio file of each track through librespot's
+//! `AudioFile`, which writes completed downloads to the audio cache. Playback of a
+//! prefetched track then reads from disk, as on a replay. Audio keys are not stored:
+//! librespot's cache has no key store, and the player requests the key when it loads
+//! the track.
+
+use std::fs;
+use std::io::Read;
+use std::os::raw::{c_char, c_int, c_void};
+use std::panic::AssertUnwindSafe;
+use std::ptr;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use futures_util::{FutureExt, StreamExt, stream};
+use librespot::audio::AudioFile;
+use librespot::core::{FileId, SpotifyUri, cache::Cache, session::Session};
+use librespot::metadata::audio::{AudioFileFormat, AudioItem};
+use tokio::task::AbortHandle;
+
+use crate::cache::CacheStats;
+use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
+use crate::ffi::read_cstr_array;
+use crate::metrics::METRICS;
+use crate::notify::Notifier;
+use crate::playback::cspot_bitrate_t;
+use crate::runtime::runtime;
+use crate::runtime_stats::{TaskKind, monitored};
+use crate::session::{
+    cache_stats_from_handle, cspot_session_t, prefetch_gate_from_handle, session_from_handle,
+};
+use crate::trace;
+
+/// Bytes read from a download between progress updates and throttle checks.
+const READ_CHUNK: usize = 64 * 1024;
+/// How often a throttled or yielding download rechecks for cancellation.
+const WAIT_SLICE: Duration = Duration::from_millis(100);
+/// How long to wait for librespot to write a finished download to the cache.
+const CACHE_WRITE_TIMEOUT: Duration = Duration::from_secs(10);
+
+/// Opaque prefetch handle for C callers.
+#[allow(non_camel_case_types)]
+pub struct cspot_prefetch_t;
+
+/// Priority of a prefetch relative to other prefetches on the same session.
+///
+/// Downloads pause while a higher-priority prefetch of the session is still running.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_prefetch_priority_t {
+    CSPOT_PREFETCH_PRIORITY_LOW = 0,
+    CSPOT_PREFETCH_PRIORITY_NORMAL = 1,
+    CSPOT_PREFETCH_PRIORITY_HIGH = 2,
+}
+
+/// Prefetch tuning passed to `cspot_cache_prefetch`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_prefetch_options_t {
+    /// Bitrate to download; should match the player's bitrate so playback finds the file.
+    pub bitrate: cspot_bitrate_t,
+    /// Tracks downloaded at the same time; 0 is treated as 1.
+    pub max_concurrent: u32,
+    /// Combined download rate of the prefetch in bytes per second; 0 means unlimited.
+    pub max_bytes_per_second: u64,
+}
+
+impl Default for cspot_prefetch_options_t {
+    fn default() -> Self {
+        Self {
+            bitrate: cspot_bitrate_t::CSPOT_BITRATE_160,
+            max_concurrent: 2,
+            max_bytes_per_second: 0,
+        }
+    }
+}
+
+/// State of one track in a prefetch.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_prefetch_state_t {
+    CSPOT_PREFETCH_QUEUED = 0,
+    CSPOT_PREFETCH_DOWNLOADING = 1,
+    /// The audio file is in the cache, either already or after downloading it.
+    CSPOT_PREFETCH_CACHED = 2,
+    CSPOT_PREFETCH_FAILED = 3,
+    CSPOT_PREFETCH_CANCELLED = 4,
+}
+
+/// Progress of one track in a prefetch.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_prefetch_item_t {
+    pub state: cspot_prefetch_state_t,
+    /// Bytes of the audio file downloaded or found in the cache.
+    pub bytes_done: u64,
+    /// Size of the audio file, or 0 until it is known.
+    pub bytes_total: u64,
+}
+
+impl Default for cspot_prefetch_item_t {
+    fn default() -> Self {
+        Self {
+            state: cspot_prefetch_state_t::CSPOT_PREFETCH_QUEUED,
+            bytes_done: 0,
+            bytes_total: 0,
+        }
+    }
+}
+
+/// Progress of a whole prefetch, summed over its tracks.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_prefetch_progress_t {
+    pub queued: usize,
+    pub downloading: usize,
+    pub cached: usize,
+    pub failed: usize,
+    pub cancelled: usize,
+    pub bytes_done: u64,
+    /// Sum of the audio file sizes known so far.
+    pub bytes_total: u64,
+    /// True once no track is queued or downloading.
+    pub finished: bool,
+}
+
+/// Callback invoked once per track when it is cached or fails.
+///
+/// The callback runs on a cspot runtime thread and should return quickly. It is not
+/// invoked for tracks that are cancelled. `item` is only valid for the duration of
+/// the call. The prefetch handle must not be freed from inside the callback.
+#[allow(non_camel_case_types)]
+pub type cspot_prefetch_callback_t = Option<
+    extern "C" fn(
+        prefetch: *mut cspot_prefetch_t,
+        index: usize,
+        item: *const cspot_prefetch_item_t,
+        user_data: *mut c_void,
+    ),
+>;
+
+/// Counts the running prefetches of a session per priority, so lower priorities can
+/// yield to higher ones.
+#[derive(Default)]
+pub(crate) struct PrefetchGate {
+    active: Mutex<[usize; 3]>,
+    changed: Condvar,
+}
+
+impl PrefetchGate {
+    fn lock_active(&self) -> std::sync::MutexGuard<'_, [usize; 3]> {
+        self.active
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Registers a running prefetch until the returned guard is dropped.
+    fn enter(self: &Arc<Self>, priority: cspot_prefetch_priority_t) -> GateGuard {
+        self.lock_active()[priority as usize] += 1;
+        METRICS.prefetch_downloads.inc();
+        GateGuard {
+            gate: Arc::clone(self),
+            priority,
+        }
+    }
+
+    /// Blocks while a higher-priority prefetch is running or until `cancelled` is set.
+    fn wait_turn(&self, priority: cspot_prefetch_priority_t, cancelled: &AtomicBool) {
+        let mut active = self.lock_active();
+        while active[priority as usize + 1..]
+            .iter()
+            .any(|count| *count > 0)
+            && !cancelled.load(Ordering::Acquire)
+        {
+            active = self
+                .changed
+                .wait_timeout(active, WAIT_SLICE)
+                .unwrap_or_else(|poisoned| poisoned.into_inner())
+                .0;
+        }
+    }
+}
+
+struct GateGuard {
+    gate: Arc<PrefetchGate>,
+    priority: cspot_prefetch_priority_t,
+}
+
+impl Drop for GateGuard {
+    fn drop(&mut self) {
+        METRICS.prefetch_downloads.dec();
+        let mut active = self.gate.lock_active();
+        active[self.priority as usize] = active[self.priority as usize].saturating_sub(1);
+        drop(active);
+        self.gate.changed.notify_all();
+    }
+}
+
+/// Paces the downloads of one prefetch to a combined byte rate.
+struct Throttle {
+    bytes_per_second: u64,
+    start: Instant,
+    consumed: Mutex<u64>,
+}
+
+impl Throttle {
+    fn new(bytes_per_second: u64) -> Self {
+        Self {
+            bytes_per_second,
+            start: Instant::now(),
+            consumed: Mutex::new(0),
+        }
+    }
+
+    /// Reserves `bytes` of the budget, blocking until they are due or until
+    /// `cancelled` is set.
+    fn pace(&self, bytes: usize, cancelled: &AtomicBool) {
+        let due = {
+            let mut consumed = self
+                .consumed
+                .lock()
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+            *consumed += bytes as u64;
+            self.start + Duration::from_secs_f64(*consumed as f64 / self.bytes_per_second as f64)
+        };
+        loop {
+            let now = Instant::now();
+            if now >= due || cancelled.load(Ordering::Acquire) {
+                return;
+            }
+            thread::sleep((due - now).min(WAIT_SLICE));
+        }
+    }
+}
+
+struct ItemSlot {
+    item: cspot_prefetch_item_t,
+    error: Option<String>,
+}
+
+struct PrefetchJob {
+    items: Mutex<Vec<ItemSlot>>,
+    cancelled: AtomicBool,
+    ready: Notifier,
+    abort: Mutex<Option<AbortHandle>>,
+    callback: cspot_prefetch_callback_t,
+    user_data: usize,
+}
+
+impl PrefetchJob {
+    fn lock_items(&self) -> std::sync::MutexGuard<'_, Vec<ItemSlot>> {
+        self.items
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    fn is_cancelled(&self) -> bool {
+        self.cancelled.load(Ordering::Acquire)
+    }
+
+    fn start_item(&self, index: usize) -> bool {
+        let mut items = self.lock_items();
+        let item = &mut items[index].item;
+        if item.state != cspot_prefetch_state_t::CSPOT_PREFETCH_QUEUED {
+            return false;
+        }
+        item.state = cspot_prefetch_state_t::CSPOT_PREFETCH_DOWNLOADING;
+        drop(items);
+        self.ready.notify();
+        true
+    }
+
+    fn set_total(&self, index: usize, bytes_total: u64) {
+        self.lock_items()[index].item.bytes_total = bytes_total;
+    }
+
+    fn set_done(&self, index: usize, bytes_done: u64) {
+        self.lock_items()[index].item.bytes_done = bytes_done;
+    }
+
+    /// Moves a track into a final state and reports it, unless it already has one.
+    fn finish_item(self: &Arc<Self>, index: usize, result: Result<u64, String>) {
+        let item = {
+            let mut items = self.lock_items();
+            let slot = &mut items[index];
+            if !matches!(
+                slot.item.state,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_QUEUED
+                    | cspot_prefetch_state_t::CSPOT_PREFETCH_DOWNLOADING
+            ) {
+                return;
+            }
+            match result {
+                Ok(bytes) => {
+                    slot.item.state = cspot_prefetch_state_t::CSPOT_PREFETCH_CACHED;
+                    slot.item.bytes_done = bytes;
+                    slot.item.bytes_total = bytes;
+                }
+                Err(message) => {
+                    slot.item.state = cspot_prefetch_state_t::CSPOT_PREFETCH_FAILED;
+                    slot.error = Some(message);
+                }
+            }
+            slot.item
+        };
+        self.ready.notify();
+        self.report(index, &item);
+    }
+
+    fn report(self: &Arc<Self>, index: usize, item: &cspot_prefetch_item_t) {
+        if let Some(callback) = self.callback {
+            callback(
+                Arc::as_ptr(self) as *mut cspot_prefetch_t,
+                index,
+                item,
+                self.user_data as *mut c_void,
+            );
+        }
+    }
+
+    /// Stops the prefetch and marks every unfinished track cancelled, without
+    /// reporting them.
+    fn cancel(&self) {
+        if self.cancelled.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        if let Some(abort) = self
+            .abort
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .take()
+        {
+            abort.abort();
+        }
+        for slot in self.lock_items().iter_mut() {
+            if matches!(
+                slot.item.state,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_QUEUED
+                    | cspot_prefetch_state_t::CSPOT_PREFETCH_DOWNLOADING
+            ) {
+                slot.item.state = cspot_prefetch_state_t::CSPOT_PREFETCH_CANCELLED;
+            }
+        }
+        self.ready.notify();
+    }
+
+    fn progress(&self) -> cspot_prefetch_progress_t {
+        let mut progress = cspot_prefetch_progress_t::default();
+        for slot in self.lock_items().iter() {
+            match slot.item.state {
+                cspot_prefetch_state_t::CSPOT_PREFETCH_QUEUED => progress.queued += 1,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_DOWNLOADING => progress.downloading += 1,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_CACHED => progress.cached += 1,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_FAILED => progress.failed += 1,
+                cspot_prefetch_state_t::CSPOT_PREFETCH_CANCELLED => progress.cancelled += 1,
+            }
+            progress.bytes_done += slot.item.bytes_done;
+            progress.bytes_total += slot.item.bytes_total;
+        }
+        progress.finished = progress.queued == 0 && progress.downloading == 0;
+        progress
+    }
+}
+
+/// Everything the tracks of one prefetch share.
+struct PrefetchContext {
+    job: Arc<PrefetchJob>,
+    session: Session,
+    cache: Arc<Cache>,
+    stats: Arc<CacheStats>,
+    gate: Arc<PrefetchGate>,
+    priority: cspot_prefetch_priority_t,
+    bitrate: cspot_bitrate_t,
+    throttle: Option<Arc<Throttle>>,
+}
+
+/// Formats in the order librespot's player picks them for a bitrate.
+fn preferred_formats(bitrate: cspot_bitrate_t) -> [AudioFileFormat; 7] {
+    use AudioFileFormat::*;
+    match bitrate {
+        cspot_bitrate_t::CSPOT_BITRATE_96 => [
+            OGG_VORBIS_96,
+            MP3_96,
+            OGG_VORBIS_160,
+            MP3_160,
+            MP3_256,
+            OGG_VORBIS_320,
+            MP3_320,
+        ],
+        cspot_bitrate_t::CSPOT_BITRATE_160 => [
+            OGG_VORBIS_160,
+            MP3_160,
+            OGG_VORBIS_96,
+            MP3_96,
+            MP3_256,
+            OGG_VORBIS_320,
+            MP3_320,
+        ],
+        cspot_bitrate_t::CSPOT_BITRATE_320 => [
+            OGG_VORBIS_320,
+            MP3_320,
+            MP3_256,
+            OGG_VORBIS_160,
+            MP3_160,
+            OGG_VORBIS_96,
+            MP3_96,
+        ],
+    }
+}
+
+/// Nominal data rate of a format, which librespot uses to size its read-ahead.
+fn bytes_per_second(format: AudioFileFormat) -> usize {
+    use AudioFileFormat::*;
+    let kbps = match format {
+        OGG_VORBIS_96 | MP3_96 => 12,
+        OGG_VORBIS_160 | MP3_160 => 20,
+        MP3_256 => 32,
+        _ => 40,
+    };
+    kbps * 1024
+}
+
+fn select_file(
+    audio_item: &AudioItem,
+    bitrate: cspot_bitrate_t,
+) -> Option<(AudioFileFormat, FileId)> {
+    preferred_formats(bitrate).into_iter().find_map(|format| {
+        audio_item
+            .files
+            .get(&format)
+            .map(|file_id| (format, *file_id))
+    })
+}
+
+fn cached_size(cache: &Cache, file_id: FileId) -> Option<u64> {
+    let path = cache.file_path(file_id)?;
+    fs::metadata(path)
+        .ok()
+        .filter(|meta| meta.is_file())
+        .map(|meta| meta.len())
+}
+
+/// Downloads one track into the cache and returns the size of its audio file.
+async fn prefetch_item(ctx: &PrefetchContext, index: usize, uri: String) -> Result<u64, String> {
+    let uri = SpotifyUri::from_uri(&uri).map_err(|err| format!("invalid URI {uri}: {err}"))?;
+    if !matches!(uri, SpotifyUri::Track { .. } | SpotifyUri::Episode { .. }) {
+        return Err("only track and episode URIs can be prefetched".to_string());
+    }
+    let metadata_span = trace::async_span("prefetch", "prefetch.metadata");
+    let audio_item = AudioItem::get_file(&ctx.session, uri)
+        .await
+        .map_err(|err| format!("failed to load track metadata: {err}"))?;
+    drop(metadata_span);
+    let (format, file_id) = select_file(&audio_item, ctx.bitrate)
+        .ok_or_else(|| "track has no audio file in a supported format".to_string())?;
+
+    let opened_at = Instant::now();
+    let open_span = trace::async_span("prefetch", "prefetch.open");
+    let file = AudioFile::open(&ctx.session, file_id, bytes_per_second(format))
+        .await
+        .map_err(|err| format!("failed to open audio file: {err}"))?;
+    drop(open_span);
+    if file.is_cached() {
+        return cached_size(&ctx.cache, file_id)
+            .ok_or_else(|| "cached audio file disappeared".to_string());
+    }
+    METRICS.prefetch_open_latency.record_since(opened_at);
+    let loader = file
+        .get_stream_loader_controller()
+        .map_err(|err| format!("failed to start download: {err}"))?;
+    let len = loader.len() as u64;
+    ctx.job.set_total(index, len);
+    if ctx.throttle.is_none() {
+        // Without a rate cap, let librespot fetch the file as fast as it can rather
+        // than only reading ahead of our reads.
+        loader.set_stream_mode();
+    }
+
+    let job = Arc::clone(&ctx.job);
+    let gate = Arc::clone(&ctx.gate);
+    let throttle = ctx.throttle.clone();
+    let priority = ctx.priority;
+    let file = tokio::task::spawn_blocking(move || {
+        download(file, &job, index, &gate, priority, throttle.as_deref())
+    })
+    .await
+    .map_err(|_| "download thread failed".to_string())??;
+
+    // librespot writes the file to the cache from its own task once the download
+    // completes, so keep the file open until it lands.
+    let deadline = Instant::now() + CACHE_WRITE_TIMEOUT;
+    let size = loop {
+        if let Some(size) = cached_size(&ctx.cache, file_id) {
+            break size;
+        }
+        if Instant::now() >= deadline {
+            return Err("download finished but was not written to the cache".to_string());
+        }
+        tokio::time::sleep(WAIT_SLICE).await;
+    };
+    drop(file);
+    ctx.stats.record_download(size);
+    Ok(size)
+}
+
+/// Reads an audio file to the end, which makes librespot download all of it.
+fn download(
+    mut file: AudioFile,
+    job: &PrefetchJob,
+    index: usize,
+    gate: &PrefetchGate,
+    priority: cspot_prefetch_priority_t,
+    throttle: Option<&Throttle>,
+) -> Result<AudioFile, String> {
+    let mut buf = vec![0u8; READ_CHUNK];
+    let mut done = 0u64;
+    loop {
+        gate.wait_turn(priority, &job.cancelled);
+        if let Some(throttle) = throttle {
+            throttle.pace(READ_CHUNK, &job.cancelled);
+        }
+        if job.is_cancelled() {
+            return Err("prefetch was cancelled".to_string());
+        }
+        let read = file
+            .read(&mut buf)
+            .map_err(|err| format!("download failed: {err}"))?;
+        if read == 0 {
+            return Ok(file);
+        }
+        done += read as u64;
+        job.set_done(index, done);
+    }
+}
+
+async fn run_prefetch(ctx: PrefetchContext, uris: Vec<String>, max_concurrent: usize) {
+    let _active = ctx.gate.enter(ctx.priority);
+    let ctx = &ctx;
+    stream::iter(uris.into_iter().enumerate())
+        .for_each_concurrent(max_concurrent, |(index, uri)| async move {
+            if !ctx.job.start_item(index) {
+                return;
+            }
+            let result = match AssertUnwindSafe(prefetch_item(ctx, index, uri))
+                .catch_unwind()
+                .await
+            {
+                Ok(result) => result,
+                Err(_) => Err("panic while prefetching".to_string()),
+            };
+            ctx.job.finish_item(index, result);
+        })
+        .await;
+}
+
+fn job_from_handle(prefetch: *const cspot_prefetch_t) -> Option<Arc<PrefetchJob>> {
+    if prefetch.is_null() {
+        return None;
+    }
+    let job = prefetch as *const PrefetchJob;
+    // Safety: prefetch must be a valid handle allocated by cspot, which owns one
+    // reference; take another for the duration of the call.
+    unsafe {
+        Arc::increment_strong_count(job);
+        Some(Arc::from_raw(job))
+    }
+}
+
+/// Initializes prefetch options with their defaults: 160 kbps, two tracks at a time,
+/// and no rate cap.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_options_init(options: *mut cspot_prefetch_options_t) {
+    if options.is_null() {
+        return;
+    }
+    // Safety: caller provided a writable options pointer.
+    unsafe {
+        *options = cspot_prefetch_options_t::default();
+    }
+}
+
+/// Downloads the audio of tracks or episodes into the session's audio cache in the
+/// background.
+///
+/// Tracks start in the order given. `options` may be null to use the defaults. The
+/// optional callback reports each track as it finishes; progress can also be polled
+/// with `cspot_prefetch_progress` and `cspot_prefetch_item`. Returns null and writes
+/// an error if the session has no audio cache. The returned handle must be released
+/// with `cspot_prefetch_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_cache_prefetch(
+    session: *const cspot_session_t,
+    uris: *const *const c_char,
+    uri_count: usize,
+    priority: cspot_prefetch_priority_t,
+    options: *const cspot_prefetch_options_t,
+    callback: cspot_prefetch_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_prefetch_t {
+    clear_error(out_error);
+    let Some(uris) = read_cstr_array(uris, uri_count, "uri", out_error) else {
+        return ptr::null_mut();
+    };
+    let options = if options.is_null() {
+        cspot_prefetch_options_t::default()
+    } else {
+        // Safety: options must point to a valid cspot_prefetch_options_t.
+        unsafe { *options }
+    };
+    let stats = cache_stats_from_handle(session);
+    let (Some(gate), Some(session)) = (
+        prefetch_gate_from_handle(session),
+        session_from_handle(session),
+    ) else {
+        write_error(out_error, "session handle was null");
+        return ptr::null_mut();
+    };
+    let (Some(stats), Some(cache)) = (stats, session.cache().cloned()) else {
+        write_error(out_error, "session has no audio cache");
+        return ptr::null_mut();
+    };
+
+    let job = Arc::new(PrefetchJob {
+        items: Mutex::new(
+            (0..uris.len())
+                .map(|_| ItemSlot {
+                    item: cspot_prefetch_item_t::default(),
+                    error: None,
+                })
+                .collect(),
+        ),
+        cancelled: AtomicBool::new(false),
+        ready: Notifier::new(),
+        abort: Mutex::new(None),
+        callback,
+        user_data: user_data as usize,
+    });
+    let ctx = PrefetchContext {
+        job: Arc::clone(&job),
+        session,
+        cache,
+        stats,
+        gate,
+        priority,
+        bitrate: options.bitrate,
+        throttle: (options.max_bytes_per_second > 0)
+            .then(|| Arc::new(Throttle::new(options.max_bytes_per_second))),
+    };
+    let max_concurrent = options.max_concurrent.max(1) as usize;
+    let task = runtime().spawn(monitored(
+        TaskKind::Prefetch,
+        run_prefetch(ctx, uris, max_concurrent),
+    ));
+    *job.abort
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner()) = Some(task.abort_handle());
+    Arc::into_raw(job) as *mut cspot_prefetch_t
+}
+
+/// Reads the combined progress of a prefetch.
+///
+/// Also resets the descriptor returned by `cspot_prefetch_fd`. Returns false without
+/// touching the descriptor if `prefetch` or `out_progress` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_progress(
+    prefetch: *const cspot_prefetch_t,
+    out_progress: *mut cspot_prefetch_progress_t,
+) -> bool {
+    let Some(job) = job_from_handle(prefetch) else {
+        return false;
+    };
+    if out_progress.is_null() {
+        return false;
+    }
+    job.ready.clear();
+    // Safety: out_progress is non-null and points to writable memory.
+    unsafe {
+        *out_progress = job.progress();
+    }
+    true
+}
+
+/// Reads the progress of the track at `index`, in the order the URIs were passed.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_item(
+    prefetch: *const cspot_prefetch_t,
+    index: usize,
+    out_item: *mut cspot_prefetch_item_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    let Some(job) = job_from_handle(prefetch) else {
+        write_error(out_error, "prefetch handle was null");
+        return false;
+    };
+    if out_item.is_null() {
+        write_error(out_error, "out_item was null");
+        return false;
+    }
+    let Some(item) = job.lock_items().get(index).map(|slot| slot.item) else {
+        write_error(out_error, "prefetch item index out of range");
+        return false;
+    };
+    // Safety: out_item is non-null and points to writable memory.
+    unsafe {
+        *out_item = item;
+    }
+    true
+}
+
+/// Returns why the track at `index` failed, or null if it has not failed.
+///
+/// The returned string is heap-allocated and must be freed with `cspot_string_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_item_error(
+    prefetch: *const cspot_prefetch_t,
+    index: usize,
+) -> *mut c_char {
+    let Some(job) = job_from_handle(prefetch) else {
+        return ptr::null_mut();
+    };
+    match job
+        .lock_items()
+        .get(index)
+        .and_then(|slot| slot.error.as_deref())
+    {
+        Some(message) => cstring_from_str_lossy(message).into_raw(),
+        None => ptr::null_mut(),
+    }
+}
+
+/// Returns a descriptor that becomes readable when a track starts or finishes.
+///
+/// `cspot_prefetch_progress` resets it. The descriptor is owned by the prefetch handle
+/// and must not be read or closed by the caller. Returns -1 if unavailable, including
+/// on platforms without file descriptors.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_fd(prefetch: *const cspot_prefetch_t) -> c_int {
+    match job_from_handle(prefetch) {
+        Some(job) => job.ready.fd(),
+        None => -1,
+    }
+}
+
+/// Cancels a prefetch. Tracks already in the cache stay there; unfinished tracks are
+/// reported as cancelled.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_cancel(prefetch: *const cspot_prefetch_t) {
+    if let Some(job) = job_from_handle(prefetch) {
+        job.cancel();
+    }
+}
+
+/// Frees a prefetch handle, cancelling it if it is still running.
+///
+/// Must not be called from inside the prefetch callback.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_prefetch_free(prefetch: *mut cspot_prefetch_t) {
+    if prefetch.is_null() {
+        return;
+    }
+    // Safety: prefetch must be a valid handle allocated by cspot.
+    let job = unsafe { Arc::from_raw(prefetch as *const PrefetchJob) };
+    job.cancel();
+}
@@ -0,0 +1,255 @@
+//! Bounded lock-free ring buffers: a single-producer/single-consumer ring of `Copy`
+//! values and a multi-producer/multi-consumer queue of owned values.
+
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+use std::ptr;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// Keeps producer and consumer indices on separate cache lines.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+impl<T> Deref for CachePadded<T> {
+    type Target = T;
+
+    fn deref(&self) -> &T {
+        &self.0
+    }
+}
+
+/// Fixed-capacity ring of `Copy` values.
+///
+/// Indices grow monotonically and are masked on access, so the ring never allocates
+/// after construction. Pushing and popping never block: a full ring rejects writes
+/// and an empty ring yields nothing.
+pub(crate) struct SpscRing<T> {
+    slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    mask: usize,
+    head: CachePadded<AtomicUsize>,
+    tail: CachePadded<AtomicUsize>,
+}
+
+// Safety: slots are only accessed through the SPSC protocol below, which hands each
+// slot to exactly one side at a time.
+unsafe impl<T: Send> Send for SpscRing<T> {}
+unsafe impl<T: Send> Sync for SpscRing<T> {}
+
+impl<T: Copy> SpscRing<T> {
+    /// Creates a ring holding at least `capacity` values, rounded up to a power of two.
+    pub(crate) fn with_capacity(capacity: usize) -> Self {
+        let capacity = capacity.max(2).next_power_of_two();
+        let slots = (0..capacity)
+            .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+            .collect();
+        Self {
+            slots,
+            mask: capacity - 1,
+            head: CachePadded(AtomicUsize::new(0)),
+            tail: CachePadded(AtomicUsize::new(0)),
+        }
+    }
+
+    pub(crate) fn capacity(&self) -> usize {
+        self.slots.len()
+    }
+
+    /// Returns the number of values waiting to be read.
+    ///
+    /// Exact for the consumer; for the producer it may overstate the value count, which
+    /// only understates the free space.
+    pub(crate) fn len(&self) -> usize {
+        let tail = self.tail.load(Ordering::Acquire);
+        let head = self.head.load(Ordering::Acquire);
+        tail.wrapping_sub(head)
+    }
+
+    pub(crate) fn is_empty(&self) -> bool {
+        self.head.load(Ordering::Acquire) == self.tail.load(Ordering::Acquire)
+    }
+
+    /// Appends as many of `values` as fit and returns how many were written.
+    ///
+    /// # Safety
+    ///
+    /// Only one thread may act as the producer at any time.
+    pub(crate) unsafe fn push_slice(&self, values: &[T]) -> usize {
+        let tail = self.tail.load(Ordering::Relaxed);
+        let head = self.head.load(Ordering::Acquire);
+        let free = self.capacity() - tail.wrapping_sub(head);
+        let count = values.len().min(free);
+        if count == 0 {
+            return 0;
+        }
+
+        let start = tail & self.mask;
+        let first = count.min(self.capacity() - start);
+        // Safety: the producer owns slots in [tail, head + capacity); the copies stay
+        // within the slot array and cover exactly `count` of those slots.
+        unsafe {
+            let base = self.slots.as_ptr() as *mut T;
+            ptr::copy_nonoverlapping(values.as_ptr(), base.add(start), first);
+            ptr::copy_nonoverlapping(values.as_ptr().add(first), base, count - first);
+        }
+        self.tail.store(tail.wrapping_add(count), Ordering::Release);
+        count
+    }
+
+    /// Appends one value, returning false if the ring is full.
+    ///
+    /// # Safety
+    ///
+    /// Only one thread may act as the producer at any time.
+    pub(crate) unsafe fn push(&self, value: T) -> bool {
+        // Safety: forwarded from the caller.
+        unsafe { self.push_slice(std::slice::from_ref(&value)) == 1 }
+    }
+
+    /// Moves up to `len` values into `out` and returns how many were read.
+    ///
+    /// # Safety
+    ///
+    /// Only one thread may act as the consumer at any time. `out` must be valid for
+    /// writes of `len` values; its previous contents are not read.
+    pub(crate) unsafe fn pop_into(&self, out: *mut T, len: usize) -> usize {
+        let head = self.head.load(Ordering::Relaxed);
+        let tail = self.tail.load(Ordering::Acquire);
+        let count = len.min(tail.wrapping_sub(head));
+        if count == 0 {
+            return 0;
+        }
+
+        let start = head & self.mask;
+        let first = count.min(self.capacity() - start);
+        // Safety: the consumer owns slots in [head, tail), which the producer fully
+        // initialized before publishing `tail`.
+        unsafe {
+            let base = self.slots.as_ptr() as *const T;
+            ptr::copy_nonoverlapping(base.add(start), out, first);
+            ptr::copy_nonoverlapping(base, out.add(first), count - first);
+        }
+        self.head.store(head.wrapping_add(count), Ordering::Release);
+        count
+    }
+}
+
+struct QueueSlot<T> {
+    /// Position this slot is next valid for: equal to the write position when free and
+    /// one past it once written.
+    seq: AtomicUsize,
+    value: UnsafeCell<MaybeUninit<T>>,
+}
+
+/// Fixed-capacity multi-producer/multi-consumer queue.
+///
+/// Each slot carries a sequence number, so producers and consumers claim slots with a
+/// single compare-and-swap and never wait on each other. A full queue rejects writes
+/// and an empty queue yields nothing.
+pub(crate) struct MpmcQueue<T> {
+    slots: Box<[QueueSlot<T>]>,
+    mask: usize,
+    enqueue_pos: CachePadded<AtomicUsize>,
+    dequeue_pos: CachePadded<AtomicUsize>,
+}
+
+// Safety: a slot's value is only touched by the thread that claimed the slot through
+// its sequence number.
+unsafe impl<T: Send> Send for MpmcQueue<T> {}
+unsafe impl<T: Send> Sync for MpmcQueue<T> {}
+
+impl<T> MpmcQueue<T> {
+    /// Creates a queue holding at least `capacity` values, rounded up to a power of two.
+    pub(crate) fn with_capacity(capacity: usize) -> Self {
+        let capacity = capacity.max(2).next_power_of_two();
+        let slots = (0..capacity)
+            .map(|index| QueueSlot {
+                seq: AtomicUsize::new(index),
+                value: UnsafeCell::new(MaybeUninit::uninit()),
+            })
+            .collect();
+        Self {
+            slots,
+            mask: capacity - 1,
+            enqueue_pos: CachePadded(AtomicUsize::new(0)),
+            dequeue_pos: CachePadded(AtomicUsize::new(0)),
+        }
+    }
+
+    /// Returns an approximate number of queued values.
+    pub(crate) fn len(&self) -> usize {
+        let tail = self.enqueue_pos.load(Ordering::Acquire);
+        let head = self.dequeue_pos.load(Ordering::Acquire);
+        tail.wrapping_sub(head).min(self.slots.len())
+    }
+
+    /// Appends a value, handing it back if the queue is full.
+    pub(crate) fn push(&self, value: T) -> Result<(), T> {
+        let mut pos = self.enqueue_pos.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let seq = slot.seq.load(Ordering::Acquire);
+            let lag = seq.wrapping_sub(pos) as isize;
+            if lag == 0 {
+                match self.enqueue_pos.compare_exchange_weak(
+                    pos,
+                    pos.wrapping_add(1),
+                    Ordering::Relaxed,
+                    Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        // Safety: the successful CAS gave this thread the free slot.
+                        unsafe {
+                            (*slot.value.get()).write(value);
+                        }
+                        slot.seq.store(pos.wrapping_add(1), Ordering::Release);
+                        return Ok(());
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if lag < 0 {
+                return Err(value);
+            } else {
+                pos = self.enqueue_pos.load(Ordering::Relaxed);
+            }
+        }
+    }
+
+    /// Removes the oldest value, or returns `None` if the queue is empty.
+    pub(crate) fn pop(&self) -> Option<T> {
+        let mut pos = self.dequeue_pos.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let seq = slot.seq.load(Ordering::Acquire);
+            let lag = seq.wrapping_sub(pos.wrapping_add(1)) as isize;
+            if lag == 0 {
+                match self.dequeue_pos.compare_exchange_weak(
+                    pos,
+                    pos.wrapping_add(1),
+                    Ordering::Relaxed,
+                    Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        // Safety: the successful CAS gave this thread the slot, which
+                        // its producer initialized before publishing `seq`.
+                        let value = unsafe { (*slot.value.get()).assume_init_read() };
+                        slot.seq
+                            .store(pos.wrapping_add(self.slots.len()), Ordering::Release);
+                        return Some(value);
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if lag < 0 {
+                return None;
+            } else {
+                pos = self.dequeue_pos.load(Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+impl<T> Drop for MpmcQueue<T> {
+    fn drop(&mut self) {
+        while self.pop().is_some() {}
+    }
+}
@@ -1,14 +1,323 @@
-use once_cell::sync::Lazy;
+//! Shared tokio runtime for cspot's C bindings.
+
+use std::panic::AssertUnwindSafe;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::Duration;
+
+use futures_util::future::{self, Either};
+use once_cell::sync::{Lazy, OnceCell};
 use tokio::runtime::{Builder, Runtime};
+use tokio::sync::Notify;
 
-static CSPOT_RUNTIME: Lazy<Runtime> = Lazy::new(|| {
-    Builder::new_multi_thread()
-        .enable_all()
-        .thread_name("cspot-runtime")
-        .build()
-        .expect("cspot: failed to build tokio runtime")
-});
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::runtime_stats;
+
+const RUNTIME_THREAD_NAME: &str = "cspot-runtime";
+
+/// Scheduler used by the cspot runtime.
+///
+/// Non-default variants are only constructed by C callers.
+#[allow(non_camel_case_types, dead_code)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_runtime_flavor_t {
+    /// A pool of worker threads; the default.
+    CSPOT_RUNTIME_MULTI_THREAD = 0,
+    /// A single scheduler thread that runs every cspot task.
+    CSPOT_RUNTIME_CURRENT_THREAD = 1,
+    /// No scheduler threads; the host drives cspot with `cspot_runtime_poll`.
+    /// Long-running work such as the Spirc task should be started with the `_async`
+    /// entry points, since a blocking call would hold the host thread.
+    CSPOT_RUNTIME_HOST_DRIVEN = 2,
+}
+
+/// Runtime configuration passed to `cspot_runtime_configure`.
+///
+/// Zero values keep tokio's defaults. Thread settings apply to every thread the
+/// runtime starts, including blocking-pool threads.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug)]
+#[repr(C)]
+pub struct cspot_runtime_config_t {
+    pub flavor: cspot_runtime_flavor_t,
+    /// Worker threads for the multi-threaded flavor; 0 uses one per core.
+    pub worker_threads: usize,
+    /// Upper bound on threads used for blocking work; 0 uses tokio's default.
+    pub max_blocking_threads: usize,
+    /// Stack size in bytes for runtime threads; 0 uses tokio's default.
+    pub thread_stack_size: usize,
+    /// CPUs runtime threads may run on, one bit per CPU; 0 leaves affinity unchanged.
+    /// Supported on Linux and Android.
+    pub cpu_affinity_mask: u64,
+    /// Whether to apply `thread_niceness` to runtime threads.
+    pub set_thread_niceness: bool,
+    /// Nice value for runtime threads, from -20 to 19. Supported on Linux and Android.
+    pub thread_niceness: i32,
+}
+
+impl Default for cspot_runtime_config_t {
+    fn default() -> Self {
+        Self {
+            flavor: cspot_runtime_flavor_t::CSPOT_RUNTIME_MULTI_THREAD,
+            worker_threads: 0,
+            max_blocking_threads: 0,
+            thread_stack_size: 0,
+            cpu_affinity_mask: 0,
+            set_thread_niceness: false,
+            thread_niceness: 0,
+        }
+    }
+}
+
+static CSPOT_RUNTIME: OnceCell<&'static Runtime> = OnceCell::new();
+static RUNTIME_CONFIG: Mutex<Option<cspot_runtime_config_t>> = Mutex::new(None);
+static HOST_DRIVEN: AtomicBool = AtomicBool::new(false);
+static HOST_WAKE: Lazy<Notify> = Lazy::new(Notify::new);
 
 pub(crate) fn runtime() -> &'static Runtime {
-    &CSPOT_RUNTIME
+    CSPOT_RUNTIME.get_or_init(|| {
+        // The lock is held while building so a concurrent `cspot_runtime_configure`
+        // either lands before the build or observes the finished runtime.
+        let config = RUNTIME_CONFIG
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        build_runtime(config.unwrap_or_default())
+    })
+}
+
+/// Returns the runtime if something has already started it.
+pub(crate) fn started_runtime() -> Option<&'static Runtime> {
+    CSPOT_RUNTIME.get().copied()
+}
+
+fn build_runtime(config: cspot_runtime_config_t) -> &'static Runtime {
+    let mut builder = match config.flavor {
+        cspot_runtime_flavor_t::CSPOT_RUNTIME_MULTI_THREAD => {
+            let mut builder = Builder::new_multi_thread();
+            if config.worker_threads > 0 {
+                builder.worker_threads(config.worker_threads);
+            }
+            builder
+        }
+        cspot_runtime_flavor_t::CSPOT_RUNTIME_CURRENT_THREAD
+        | cspot_runtime_flavor_t::CSPOT_RUNTIME_HOST_DRIVEN => Builder::new_current_thread(),
+    };
+    builder
+        .enable_all()
+        .thread_name(RUNTIME_THREAD_NAME)
+        .on_thread_start(move || {
+            runtime_stats::thread_started();
+            apply_thread_settings(&config);
+        })
+        .on_thread_stop(runtime_stats::thread_stopped)
+        .on_thread_park(runtime_stats::worker_parked)
+        .on_thread_unpark(runtime_stats::worker_unparked);
+    if config.max_blocking_threads > 0 {
+        builder.max_blocking_threads(config.max_blocking_threads);
+    }
+    if config.thread_stack_size > 0 {
+        builder.thread_stack_size(config.thread_stack_size);
+    }
+
+    // The runtime lives for the rest of the process, like any other static.
+    let runtime: &'static Runtime = Box::leak(Box::new(
+        builder
+            .build()
+            .expect("cspot: failed to build tokio runtime"),
+    ));
+    runtime_stats::runtime_built();
+    match config.flavor {
+        cspot_runtime_flavor_t::CSPOT_RUNTIME_MULTI_THREAD => {}
+        cspot_runtime_flavor_t::CSPOT_RUNTIME_CURRENT_THREAD => {
+            spawn_driver_thread(runtime, config)
+        }
+        cspot_runtime_flavor_t::CSPOT_RUNTIME_HOST_DRIVEN => {
+            HOST_DRIVEN.store(true, Ordering::Release);
+        }
+    }
+    runtime
+}
+
+/// Tells a host-driven runtime that cspot has work for the host, so a pending
+/// `cspot_runtime_poll` returns early. No-op in the other modes.
+pub(crate) fn wake_host() {
+    if HOST_DRIVEN.load(Ordering::Acquire) {
+        HOST_WAKE.notify_one();
+    }
+}
+
+/// Drives a current-thread runtime so spawned tasks make progress while no caller is
+/// inside `block_on`. Other threads may still `block_on` their own futures.
+fn spawn_driver_thread(runtime: &'static Runtime, config: cspot_runtime_config_t) {
+    let mut thread = std::thread::Builder::new().name(RUNTIME_THREAD_NAME.to_string());
+    if config.thread_stack_size > 0 {
+        thread = thread.stack_size(config.thread_stack_size);
+    }
+    thread
+        .spawn(move || {
+            apply_thread_settings(&config);
+            runtime.block_on(std::future::pending::<()>());
+        })
+        .expect("cspot: failed to start runtime thread");
+}
+
+fn apply_thread_settings(config: &cspot_runtime_config_t) {
+    if config.cpu_affinity_mask != 0 {
+        if let Err(err) = set_current_thread_affinity(config.cpu_affinity_mask) {
+            log::warn!("failed to set cspot runtime thread affinity: {err}");
+        }
+    }
+    if config.set_thread_niceness {
+        if let Err(err) = set_current_thread_niceness(config.thread_niceness) {
+            log::warn!("failed to set cspot runtime thread niceness: {err}");
+        }
+    }
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn set_current_thread_affinity(mask: u64) -> std::io::Result<()> {
+    // Safety: cpu_set_t is plain data and valid when zeroed.
+    let mut set: libc::cpu_set_t = unsafe { std::mem::zeroed() };
+    for cpu in 0..64 {
+        if mask & (1 << cpu) != 0 {
+            // Safety: cpu is below CPU_SETSIZE and set is a valid cpu_set_t.
+            unsafe { libc::CPU_SET(cpu, &mut set) };
+        }
+    }
+    // Safety: set is a valid cpu_set_t of the given size; pid 0 is the calling thread.
+    let result =
+        unsafe { libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) };
+    if result != 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    Ok(())
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn set_current_thread_affinity(_mask: u64) -> std::io::Result<()> {
+    Err(std::io::Error::new(
+        std::io::ErrorKind::Unsupported,
+        "thread affinity is not supported on this platform",
+    ))
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn set_current_thread_niceness(niceness: i32) -> std::io::Result<()> {
+    // Linux applies PRIO_PROCESS priorities per thread when given a thread id.
+    // Safety: gettid has no arguments and cannot fail.
+    let tid = unsafe { libc::syscall(libc::SYS_gettid) } as libc::id_t;
+    // Safety: setpriority has no pointer arguments.
+    if unsafe { libc::setpriority(libc::PRIO_PROCESS, tid, niceness) } != 0 {
+        return Err(std::io::Error::last_os_error());
+    }
+    Ok(())
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn set_current_thread_niceness(_niceness: i32) -> std::io::Result<()> {
+    Err(std::io::Error::new(
+        std::io::ErrorKind::Unsupported,
+        "per-thread niceness is not supported on this platform",
+    ))
+}
+
+/// Initializes runtime configuration values to tokio's defaults.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_config_init(config: *mut cspot_runtime_config_t) {
+    if config.is_null() {
+        return;
+    }
+    // Safety: caller provided a writable config pointer.
+    unsafe {
+        *config = cspot_runtime_config_t::default();
+    }
+}
+
+/// Configures the runtime cspot uses for all of its work.
+///
+/// Must be called before any other cspot function that touches the runtime; the
+/// runtime is created on first use and cannot be reconfigured afterwards. Calling it
+/// again before first use replaces the previous configuration. Passing null restores
+/// the defaults.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_configure(
+    config: *const cspot_runtime_config_t,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    let config = if config.is_null() {
+        cspot_runtime_config_t::default()
+    } else {
+        // Safety: config must point to a valid cspot_runtime_config_t.
+        unsafe { *config }
+    };
+    if config.thread_stack_size != 0 && config.thread_stack_size < 64 * 1024 {
+        write_error(out_error, "thread_stack_size must be at least 64 KiB");
+        return false;
+    }
+    if config.set_thread_niceness && !(-20..=19).contains(&config.thread_niceness) {
+        write_error(out_error, "thread_niceness must be between -20 and 19");
+        return false;
+    }
+
+    let mut pending = RUNTIME_CONFIG
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    if CSPOT_RUNTIME.get().is_some() {
+        write_error(out_error, "cspot runtime is already running");
+        return false;
+    }
+    *pending = Some(config);
+    true
+}
+
+/// Drives the cspot runtime on the calling thread for up to `timeout_ms` milliseconds.
+///
+/// In `CSPOT_RUNTIME_HOST_DRIVEN` mode nothing runs unless a thread is inside this call
+/// or a blocking cspot function, so the host should call it regularly from its own
+/// loop. It returns early, with true, when cspot has something for the host: a player
+/// event was queued, an asynchronous operation finished, or `cspot_runtime_wake` was
+/// called. Otherwise it returns false once the timeout elapses. In the other modes it
+/// only waits, since cspot's own threads drive the runtime.
+///
+/// Must not be called from a cspot callback.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_poll(timeout_ms: u32) -> bool {
+    let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
+        runtime().block_on(async {
+            let sleep = tokio::time::sleep(Duration::from_millis(u64::from(timeout_ms)));
+            let woken = HOST_WAKE.notified();
+            match future::select(Box::pin(woken), Box::pin(sleep)).await {
+                Either::Left(_) => true,
+                Either::Right(_) => false,
+            }
+        })
+    }));
+    result.unwrap_or(false)
+}
+
+/// Runs cspot work that is ready now without waiting for timers or I/O.
+///
+/// Each pass lets every queued task run once and polls I/O without blocking. Passes
+/// continue a bounded number of times, so a task that keeps rescheduling itself cannot
+/// hold the host thread. Must not be called from a cspot callback.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_run_until_idle() {
+    const IDLE_PASSES: usize = 16;
+    let _ = std::panic::catch_unwind(AssertUnwindSafe(|| {
+        runtime().block_on(async {
+            for _ in 0..IDLE_PASSES {
+                tokio::task::yield_now().await;
+            }
+        })
+    }));
+}
+
+/// Makes a pending or the next `cspot_runtime_poll` return immediately.
+///
+/// Safe to call from any thread.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_wake() {
+    HOST_WAKE.notify_one();
 }
@@ -0,0 +1,387 @@
+//! Health statistics for the shared cspot runtime.
+//!
+//! Every cspot device shares one runtime, so a task that blocks a worker delays all of
+//! them. Worker load is measured with the runtime's park and unpark hooks, and the
+//! tasks cspot spawns are wrapped in `Monitored`, which times each poll and lets a
+//! watchdog thread report polls that have not returned.
+
+use std::future::Future;
+use std::pin::Pin;
+use std::ptr;
+use std::sync::atomic::{AtomicU8, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, Once};
+use std::task::{Context, Poll};
+use std::thread::{self, Thread};
+use std::time::{Duration, Instant};
+
+use once_cell::sync::{Lazy, OnceCell};
+use tokio::runtime::{RuntimeFlavor, RuntimeMetrics};
+
+use crate::metrics::{Histogram, cspot_histogram_t};
+use crate::runtime::started_runtime;
+
+/// Shortest interval at which the watchdog looks for stalled polls.
+const MIN_WATCHDOG_INTERVAL: Duration = Duration::from_millis(10);
+
+/// Origin of the timestamps below; set when the runtime is built.
+static EPOCH: Lazy<Instant> = Lazy::new(Instant::now);
+static THREADS_ALIVE: AtomicUsize = AtomicUsize::new(0);
+/// Busy time of parked workers; workers that are running add theirs when sampled.
+static WORKER_BUSY_NS: AtomicU64 = AtomicU64::new(0);
+static POLL_TIME: Histogram = Histogram::new();
+static LONG_POLLS: AtomicU64 = AtomicU64::new(0);
+/// Polls at least this long are reported; 0 disables reporting.
+static LONG_POLL_THRESHOLD_NS: AtomicU64 = AtomicU64::new(0);
+/// Time and busy total at the previous `cspot_runtime_stats` call.
+static LAST_SAMPLE: Mutex<(u64, u64)> = Mutex::new((0, 0));
+static SLOTS: Mutex<Vec<Arc<ThreadSlot>>> = Mutex::new(Vec::new());
+static WATCHDOG: OnceCell<Thread> = OnceCell::new();
+static WATCHDOG_START: Once = Once::new();
+
+thread_local! {
+    static SLOT: Arc<ThreadSlot> = ThreadSlot::register();
+}
+
+/// Tasks spawned by cspot whose polls are timed.
+#[derive(Clone, Copy, Debug)]
+#[repr(u8)]
+pub(crate) enum TaskKind {
+    AsyncOp = 1,
+    Spirc,
+    SpircStatus,
+    CacheStats,
+    Discovery,
+    Prefetch,
+    MetricsServer,
+}
+
+impl TaskKind {
+    const ALL: [TaskKind; 7] = [
+        TaskKind::AsyncOp,
+        TaskKind::Spirc,
+        TaskKind::SpircStatus,
+        TaskKind::CacheStats,
+        TaskKind::Discovery,
+        TaskKind::Prefetch,
+        TaskKind::MetricsServer,
+    ];
+
+    fn from_u8(value: u8) -> Option<Self> {
+        Self::ALL.get(usize::from(value).checked_sub(1)?).copied()
+    }
+
+    fn name(self) -> &'static str {
+        match self {
+            TaskKind::AsyncOp => "async operation",
+            TaskKind::Spirc => "spirc",
+            TaskKind::SpircStatus => "spirc status",
+            TaskKind::CacheStats => "cache stats",
+            TaskKind::Discovery => "discovery",
+            TaskKind::Prefetch => "prefetch",
+            TaskKind::MetricsServer => "metrics server",
+        }
+    }
+}
+
+/// State of one thread that runs cspot tasks, shared with the watchdog and
+/// `cspot_runtime_stats`. Timestamps are nanoseconds since `EPOCH`, with 0 for none.
+struct ThreadSlot {
+    poll_started_ns: AtomicU64,
+    kind: AtomicU8,
+    /// Start of the poll the watchdog last reported, so each stall is reported once.
+    reported_ns: AtomicU64,
+    /// When this worker last unparked, or 0 while it is parked.
+    busy_since_ns: AtomicU64,
+}
+
+impl ThreadSlot {
+    fn register() -> Arc<Self> {
+        let slot = Arc::new(Self {
+            poll_started_ns: AtomicU64::new(0),
+            kind: AtomicU8::new(0),
+            reported_ns: AtomicU64::new(0),
+            busy_since_ns: AtomicU64::new(0),
+        });
+        let mut slots = lock_slots();
+        // The thread-local holds the other reference while its thread is alive.
+        slots.retain(|slot| Arc::strong_count(slot) > 1);
+        slots.push(Arc::clone(&slot));
+        slot
+    }
+}
+
+/// Ends a timed poll when dropped, including when the task panics.
+struct PollGuard<'a> {
+    slot: &'a ThreadSlot,
+    kind: TaskKind,
+    start_ns: u64,
+}
+
+impl Drop for PollGuard<'_> {
+    fn drop(&mut self) {
+        self.slot.poll_started_ns.store(0, Ordering::Relaxed);
+        let elapsed = Duration::from_nanos(now_ns().saturating_sub(self.start_ns));
+        POLL_TIME.record(elapsed);
+        let threshold_ns = LONG_POLL_THRESHOLD_NS.load(Ordering::Relaxed);
+        if threshold_ns != 0 && elapsed.as_nanos() >= u128::from(threshold_ns) {
+            LONG_POLLS.fetch_add(1, Ordering::Relaxed);
+            log::warn!(
+                "cspot {} task held a runtime thread for {:.1} ms in one poll",
+                self.kind.name(),
+                elapsed.as_secs_f64() * 1000.0
+            );
+        }
+    }
+}
+
+fn lock_slots() -> std::sync::MutexGuard<'static, Vec<Arc<ThreadSlot>>> {
+    SLOTS
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+fn now_ns() -> u64 {
+    // 0 marks an empty timestamp, so the first nanosecond is folded into the next.
+    (EPOCH.elapsed().as_nanos() as u64).max(1)
+}
+
+/// A future whose polls are timed and watched for stalls.
+pub(crate) struct Monitored<F> {
+    kind: TaskKind,
+    future: F,
+}
+
+/// Wraps `future` so the time each poll takes is recorded under `kind`.
+pub(crate) fn monitored<F: Future>(kind: TaskKind, future: F) -> Monitored<F> {
+    Monitored { kind, future }
+}
+
+impl<F: Future> Future for Monitored<F> {
+    type Output = F::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<F::Output> {
+        let kind = self.kind;
+        // Safety: `future` is structurally pinned; it is never moved out of `self`.
+        let future = unsafe { self.map_unchecked_mut(|this| &mut this.future) };
+        SLOT.with(|slot| {
+            if slot.poll_started_ns.load(Ordering::Relaxed) != 0 {
+                // An enclosing monitored future is timing this poll; name the inner
+                // task so a stall report points at it.
+                let outer = slot.kind.swap(kind as u8, Ordering::Relaxed);
+                let result = future.poll(cx);
+                slot.kind.store(outer, Ordering::Relaxed);
+                return result;
+            }
+            let start_ns = now_ns();
+            slot.kind.store(kind as u8, Ordering::Relaxed);
+            slot.poll_started_ns.store(start_ns, Ordering::Release);
+            let _guard = PollGuard {
+                slot,
+                kind,
+                start_ns,
+            };
+            future.poll(cx)
+        })
+    }
+}
+
+/// Starts the statistics clock; called once the runtime is built.
+pub(crate) fn runtime_built() {
+    Lazy::force(&EPOCH);
+}
+
+/// Runtime hook for every thread the runtime starts, including blocking threads.
+pub(crate) fn thread_started() {
+    THREADS_ALIVE.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Runtime hook for every thread the runtime stops.
+pub(crate) fn thread_stopped() {
+    worker_parked();
+    THREADS_ALIVE.fetch_sub(1, Ordering::Relaxed);
+}
+
+/// Runtime hook for a worker that has woken up to run tasks.
+pub(crate) fn worker_unparked() {
+    let _ = SLOT.try_with(|slot| slot.busy_since_ns.store(now_ns(), Ordering::Relaxed));
+}
+
+/// Runtime hook for a worker that has run out of tasks.
+pub(crate) fn worker_parked() {
+    let _ = SLOT.try_with(|slot| {
+        let since = slot.busy_since_ns.swap(0, Ordering::Relaxed);
+        if since != 0 {
+            WORKER_BUSY_NS.fetch_add(now_ns().saturating_sub(since), Ordering::Relaxed);
+        }
+    });
+}
+
+/// Total worker busy time so far, including workers that are running now.
+fn worker_busy_ns(now_ns: u64) -> u64 {
+    let running: u64 = lock_slots()
+        .iter()
+        .map(|slot| match slot.busy_since_ns.load(Ordering::Relaxed) {
+            0 => 0,
+            since => now_ns.saturating_sub(since),
+        })
+        .sum();
+    WORKER_BUSY_NS.load(Ordering::Relaxed) + running
+}
+
+/// Reports polls that have run for at least the threshold and not yet returned, since
+/// the poll's own report only comes once it does.
+fn run_watchdog() {
+    loop {
+        let threshold_ns = LONG_POLL_THRESHOLD_NS.load(Ordering::Relaxed);
+        if threshold_ns == 0 {
+            thread::park();
+            continue;
+        }
+        let threshold = Duration::from_nanos(threshold_ns);
+        thread::park_timeout((threshold / 2).max(MIN_WATCHDOG_INTERVAL));
+
+        let now = now_ns();
+        // Collected first so a slow log callback does not hold the slot list.
+        let stalled: Vec<(&'static str, u64)> = lock_slots()
+            .iter()
+            .filter_map(|slot| {
+                let started = slot.poll_started_ns.load(Ordering::Acquire);
+                if started == 0 || now.saturating_sub(started) < threshold_ns {
+                    return None;
+                }
+                if slot.reported_ns.swap(started, Ordering::Relaxed) == started {
+                    return None;
+                }
+                let kind = TaskKind::from_u8(slot.kind.load(Ordering::Relaxed))
+                    .map_or("unknown", TaskKind::name);
+                Some((kind, now - started))
+            })
+            .collect();
+        for (kind, running_ns) in stalled {
+            log::warn!(
+                "cspot {kind} task has been running for {:.1} ms without yielding; \
+                 other cspot work on its thread is delayed",
+                Duration::from_nanos(running_ns).as_secs_f64() * 1000.0
+            );
+        }
+    }
+}
+
+#[cfg(tokio_unstable)]
+fn local_queue_depth(metrics: &RuntimeMetrics) -> i64 {
+    (0..metrics.num_workers())
+        .map(|worker| metrics.worker_local_queue_depth(worker) as i64)
+        .sum()
+}
+
+#[cfg(not(tokio_unstable))]
+fn local_queue_depth(_metrics: &RuntimeMetrics) -> i64 {
+    -1
+}
+
+/// Health of the cspot runtime, filled by `cspot_runtime_stats`.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct cspot_runtime_stats_t {
+    /// Worker threads; 1 for the current-thread and host-driven flavors.
+    pub workers: usize,
+    /// Threads started for blocking work that are still alive, busy or idle.
+    pub blocking_threads: usize,
+    /// Tasks spawned on the runtime that have not finished.
+    pub alive_tasks: usize,
+    /// Tasks waiting in the runtime's shared queue.
+    pub global_queue_depth: usize,
+    /// Tasks waiting in workers' own queues, or -1 unless cspot was built with
+    /// `RUSTFLAGS="--cfg tokio_unstable"`.
+    pub local_queue_depth: i64,
+    /// Fraction of worker time spent running tasks since the previous call, or since
+    /// the runtime started on the first call, from 0 to 1.
+    pub worker_busy_ratio: f64,
+    /// Total time workers have spent running tasks, in microseconds.
+    pub worker_busy_us: u64,
+    /// Polls of cspot tasks that reached the watchdog threshold.
+    pub long_polls: u64,
+    /// Time taken by each poll of a task cspot spawned, including Spirc tasks,
+    /// asynchronous operations and event forwarding. Tasks spawned inside librespot
+    /// are not timed, but count towards `worker_busy_ratio`.
+    pub poll_time: cspot_histogram_t,
+}
+
+/// Copies the current health of the cspot runtime into `out_stats`.
+///
+/// Every field is zero until the runtime has started; this call does not start it.
+/// Returns false if `out_stats` is null.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_stats(out_stats: *mut cspot_runtime_stats_t) -> bool {
+    if out_stats.is_null() {
+        return false;
+    }
+    let mut stats = cspot_runtime_stats_t::default();
+    if let Some(runtime) = started_runtime() {
+        let metrics = runtime.metrics();
+        let workers = metrics.num_workers();
+        let threads = THREADS_ALIVE.load(Ordering::Relaxed);
+        let now = now_ns();
+        let busy_ns = worker_busy_ns(now);
+        let ratio = {
+            let mut last = LAST_SAMPLE
+                .lock()
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+            let (last_ns, last_busy_ns) = std::mem::replace(&mut *last, (now, busy_ns));
+            let capacity = now.saturating_sub(last_ns) as f64 * workers as f64;
+            if capacity > 0.0 {
+                (busy_ns.saturating_sub(last_busy_ns) as f64 / capacity).clamp(0.0, 1.0)
+            } else {
+                0.0
+            }
+        };
+        stats = cspot_runtime_stats_t {
+            workers,
+            // Only the multi-threaded flavor starts its workers through the runtime's
+            // thread hooks.
+            blocking_threads: match runtime.handle().runtime_flavor() {
+                RuntimeFlavor::MultiThread => threads.saturating_sub(workers),
+                _ => threads,
+            },
+            alive_tasks: metrics.num_alive_tasks(),
+            global_queue_depth: metrics.global_queue_depth(),
+            local_queue_depth: local_queue_depth(&metrics),
+            worker_busy_ratio: ratio,
+            worker_busy_us: busy_ns / 1000,
+            long_polls: LONG_POLLS.load(Ordering::Relaxed),
+            poll_time: POLL_TIME.snapshot(),
+        };
+    }
+    // Safety: out_stats is non-null and points to writable memory.
+    unsafe { ptr::write(out_stats, stats) };
+    true
+}
+
+/// Logs a warning when a cspot task polls for at least `threshold_ms` milliseconds.
+///
+/// A poll is reported once it returns, and also while it is still running, by a
+/// watchdog thread started on first use, so a task stuck in a blocking call such as a
+/// slow log callback is reported before it finishes. Such polls are counted in
+/// `cspot_runtime_stats_t::long_polls`. Passing 0 turns reporting off, which is the
+/// default. May be called at any time.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_runtime_set_watchdog(threshold_ms: u32) {
+    LONG_POLL_THRESHOLD_NS.store(u64::from(threshold_ms) * 1_000_000, Ordering::Relaxed);
+    if threshold_ms > 0 {
+        WATCHDOG_START.call_once(|| {
+            match thread::Builder::new()
+                .name("cspot-watchdog".to_string())
+                .spawn(run_watchdog)
+            {
+                Ok(handle) => {
+                    let _ = WATCHDOG.set(handle.thread().clone());
+                }
+                Err(err) => log::warn!("failed to start cspot watchdog thread: {err}"),
+            }
+        });
+    }
+    if let Some(watchdog) = WATCHDOG.get() {
+        watchdog.unpark();
+    }
+}
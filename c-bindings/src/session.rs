@@ -1,15 +1,21 @@
 //! C bindings for librespot session setup.
 
 use std::ffi::CString;
-use std::os::raw::c_char;
+use std::os::raw::{c_char, c_void};
 use std::panic::AssertUnwindSafe;
 use std::ptr;
+use std::sync::Arc;
 
-use librespot::core::{config::SessionConfig, session::Session};
+use librespot::core::{cache::Cache, config::SessionConfig, session::Session};
 
+use crate::async_op::{cspot_async_callback_t, cspot_async_op_t, spawn_async_op, take_async_value};
+use crate::cache::{CacheSettings, CacheStats, cspot_cache_config_t};
 use crate::error::{clear_error, cspot_error_t, cstring_from_str_lossy, write_error};
 use crate::ffi::read_cstr;
+use crate::metrics::METRICS;
+use crate::prefetch::PrefetchGate;
 use crate::runtime::runtime;
+use crate::trace;
 
 /// Opaque session handle for C callers.
 #[allow(non_camel_case_types)]
@@ -17,6 +23,47 @@ pub struct cspot_session_t;
 
 struct SessionHandle {
     session: Session,
+    cache_stats: Option<Arc<CacheStats>>,
+    prefetch_gate: Arc<PrefetchGate>,
+}
+
+impl Drop for SessionHandle {
+    fn drop(&mut self) {
+        METRICS.sessions.dec();
+    }
+}
+
+/// Builds a session; must run inside the cspot runtime.
+fn new_session(
+    device_id: String,
+    cache: Option<Cache>,
+    cache_stats: Option<Arc<CacheStats>>,
+) -> SessionHandle {
+    let _span = trace::span("startup", "session.new");
+    let mut config = SessionConfig::default();
+    config.device_id = device_id;
+    METRICS.sessions.inc();
+    SessionHandle {
+        session: Session::new(config, cache),
+        cache_stats,
+        prefetch_gate: Arc::new(PrefetchGate::default()),
+    }
+}
+
+/// Reads the device id and cache configuration shared by the cached create functions.
+fn read_cached_session_args(
+    device_id: *const c_char,
+    cache_config: *const cspot_cache_config_t,
+    out_error: *mut *mut cspot_error_t,
+) -> Option<(String, CacheSettings)> {
+    let device_id = read_cstr(device_id, "device_id", out_error)?;
+    if cache_config.is_null() {
+        write_error(out_error, "cache config was null");
+        return None;
+    }
+    // Safety: cache_config must point to a valid cspot_cache_config_t.
+    let settings = CacheSettings::from_config(unsafe { &*cache_config });
+    Some((device_id, settings))
 }
 
 /// Creates a new session using the provided device id.
@@ -34,15 +81,11 @@ pub extern "C" fn cspot_session_create(
     };
 
     let result = std::panic::catch_unwind(AssertUnwindSafe(|| {
-        runtime().block_on(async {
-            let mut config = SessionConfig::default();
-            config.device_id = device_id;
-            Session::new(config, None)
-        })
+        runtime().block_on(async { new_session(device_id, None, None) })
     }));
 
     match result {
-        Ok(session) => Box::into_raw(Box::new(SessionHandle { session })) as *mut cspot_session_t,
+        Ok(handle) => Box::into_raw(Box::new(handle)) as *mut cspot_session_t,
         Err(_) => {
             write_error(out_error, "panic while creating session");
             ptr::null_mut()
@@ -50,6 +93,111 @@ pub extern "C" fn cspot_session_create(
     }
 }
 
+/// Creates a new session without blocking.
+///
+/// Returns an operation handle that completes once the session exists; claim the
+/// session with `cspot_async_op_take_session`. The operation handle must be released
+/// with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_session_create_async(
+    device_id: *const c_char,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let device_id = match read_cstr(device_id, "device_id", out_error) {
+        Some(value) => value,
+        None => return ptr::null_mut(),
+    };
+    spawn_async_op(
+        async move { Ok(new_session(device_id, None, None)) },
+        callback,
+        user_data,
+    )
+}
+
+/// Creates a new session that caches audio files and credentials on disk.
+///
+/// Replayed tracks are read from the audio cache instead of being downloaded again.
+/// The directories are created if needed. The returned handle must be released with
+/// `cspot_session_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_session_create_with_cache(
+    device_id: *const c_char,
+    cache_config: *const cspot_cache_config_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_session_t {
+    clear_error(out_error);
+    let Some((device_id, settings)) = read_cached_session_args(device_id, cache_config, out_error)
+    else {
+        return ptr::null_mut();
+    };
+
+    let result = std::panic::catch_unwind(AssertUnwindSafe(|| -> Result<SessionHandle, String> {
+        let (cache, stats) = settings.open()?;
+        Ok(runtime().block_on(async { new_session(device_id, Some(cache), stats) }))
+    }));
+
+    match result {
+        Ok(Ok(handle)) => Box::into_raw(Box::new(handle)) as *mut cspot_session_t,
+        Ok(Err(err)) => {
+            write_error(out_error, err);
+            ptr::null_mut()
+        }
+        Err(_) => {
+            write_error(out_error, "panic while creating session");
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Creates a new session with an on-disk cache without blocking.
+///
+/// Opening the cache and creating the session both happen on the runtime; claim the
+/// session with `cspot_async_op_take_session`. The operation handle must be released
+/// with `cspot_async_op_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_session_create_with_cache_async(
+    device_id: *const c_char,
+    cache_config: *const cspot_cache_config_t,
+    callback: cspot_async_callback_t,
+    user_data: *mut c_void,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_async_op_t {
+    clear_error(out_error);
+    let Some((device_id, settings)) = read_cached_session_args(device_id, cache_config, out_error)
+    else {
+        return ptr::null_mut();
+    };
+    spawn_async_op(
+        async move {
+            // Opening the cache creates directories and scans the audio directory.
+            let (cache, stats) = tokio::task::spawn_blocking(move || settings.open())
+                .await
+                .map_err(|_| "cache open thread failed".to_string())??;
+            Ok(new_session(device_id, Some(cache), stats))
+        },
+        callback,
+        user_data,
+    )
+}
+
+/// Claims the session produced by `cspot_session_create_async`.
+///
+/// Returns null and writes an error if the operation has not completed successfully.
+/// The returned handle must be released with `cspot_session_free`.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_async_op_take_session(
+    op: *const cspot_async_op_t,
+    out_error: *mut *mut cspot_error_t,
+) -> *mut cspot_session_t {
+    match take_async_value::<SessionHandle>(op, out_error) {
+        Some(handle) => Box::into_raw(Box::new(handle)) as *mut cspot_session_t,
+        None => ptr::null_mut(),
+    }
+}
+
 /// Returns the session username, or null if unavailable.
 ///
 /// The returned string is heap-allocated and must be freed with `cspot_string_free`.
@@ -90,3 +238,23 @@ pub(crate) fn session_from_handle(session: *const cspot_session_t) -> Option<Ses
     let handle = unsafe { &*(session as *const SessionHandle) };
     Some(handle.session.clone())
 }
+
+pub(crate) fn cache_stats_from_handle(session: *const cspot_session_t) -> Option<Arc<CacheStats>> {
+    if session.is_null() {
+        return None;
+    }
+    // Safety: session must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(session as *const SessionHandle) };
+    handle.cache_stats.clone()
+}
+
+pub(crate) fn prefetch_gate_from_handle(
+    session: *const cspot_session_t,
+) -> Option<Arc<PrefetchGate>> {
+    if session.is_null() {
+        return None;
+    }
+    // Safety: session must be a valid handle allocated by cspot.
+    let handle = unsafe { &*(session as *const SessionHandle) };
+    Some(Arc::clone(&handle.prefetch_gate))
+}
@@ -0,0 +1,213 @@
+//! Audio sinks that hand decoded PCM to C callers, and timing for librespot's backends.
+
+use std::os::raw::c_void;
+
+use librespot::playback::NUM_CHANNELS;
+use librespot::playback::audio_backend::{Sink, SinkError, SinkResult};
+use librespot::playback::config::AudioFormat;
+use librespot::playback::convert::Converter;
+use librespot::playback::decoder::AudioPacket;
+use librespot::playback::dither::DithererBuilder;
+
+use crate::convert::PcmConverter;
+use crate::metrics::PacketTimer;
+use crate::trace;
+
+/// PCM sample formats exposed to C callers.
+///
+/// Samples are native-endian. `CSPOT_AUDIO_FORMAT_S24` stores 24-bit samples in the low
+/// bits of 32-bit integers; `CSPOT_AUDIO_FORMAT_S24_3` packs them into 3 bytes.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+#[repr(C)]
+pub enum cspot_audio_format_t {
+    CSPOT_AUDIO_FORMAT_F64 = 0,
+    CSPOT_AUDIO_FORMAT_F32 = 1,
+    CSPOT_AUDIO_FORMAT_S32 = 2,
+    CSPOT_AUDIO_FORMAT_S24 = 3,
+    CSPOT_AUDIO_FORMAT_S24_3 = 4,
+    CSPOT_AUDIO_FORMAT_S16 = 5,
+}
+
+impl From<cspot_audio_format_t> for AudioFormat {
+    fn from(value: cspot_audio_format_t) -> Self {
+        match value {
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_F64 => AudioFormat::F64,
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_F32 => AudioFormat::F32,
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_S32 => AudioFormat::S32,
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_S24 => AudioFormat::S24,
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_S24_3 => AudioFormat::S24_3,
+            cspot_audio_format_t::CSPOT_AUDIO_FORMAT_S16 => AudioFormat::S16,
+        }
+    }
+}
+
+/// Callbacks that receive a player's audio output.
+///
+/// Audio is always stereo at 44.1 kHz, interleaved, in the format requested when the
+/// player was created. All callbacks run on the player's audio thread. `write` receives
+/// `frame_count` frames and the buffer is only valid for the duration of the call; it
+/// should block while the host's output is full, since playback is paced by how fast
+/// `write` returns. `start` and `stop` are optional. Returning false from any callback
+/// reports a sink error to the player.
+#[allow(non_camel_case_types)]
+#[derive(Clone, Copy)]
+#[repr(C)]
+pub struct cspot_sink_callbacks_t {
+    pub start: Option<extern "C" fn(user_data: *mut c_void) -> bool>,
+    pub stop: Option<extern "C" fn(user_data: *mut c_void) -> bool>,
+    pub write: Option<
+        extern "C" fn(frames: *const c_void, frame_count: usize, user_data: *mut c_void) -> bool,
+    >,
+    pub user_data: *mut c_void,
+}
+
+type WriteCallback =
+    extern "C" fn(frames: *const c_void, frame_count: usize, user_data: *mut c_void) -> bool;
+
+/// Validated copy of `cspot_sink_callbacks_t` that can move to the audio thread.
+#[derive(Clone, Copy)]
+pub(crate) struct SinkCallbacks {
+    start: Option<extern "C" fn(user_data: *mut c_void) -> bool>,
+    stop: Option<extern "C" fn(user_data: *mut c_void) -> bool>,
+    write: WriteCallback,
+    user_data: usize,
+}
+
+impl SinkCallbacks {
+    /// Returns `None` if `callbacks` has no write callback.
+    pub(crate) fn new(callbacks: &cspot_sink_callbacks_t) -> Option<Self> {
+        Some(Self {
+            start: callbacks.start,
+            stop: callbacks.stop,
+            write: callbacks.write?,
+            user_data: callbacks.user_data as usize,
+        })
+    }
+}
+
+/// Sink that forwards converted PCM to C callbacks.
+pub(crate) struct CallbackSink {
+    callbacks: SinkCallbacks,
+    format: AudioFormat,
+    converter: PcmConverter,
+    timer: PacketTimer,
+}
+
+impl CallbackSink {
+    pub(crate) fn new(
+        callbacks: SinkCallbacks,
+        format: AudioFormat,
+        ditherer: Option<DithererBuilder>,
+    ) -> Self {
+        Self {
+            callbacks,
+            format,
+            converter: PcmConverter::new(ditherer),
+            timer: PacketTimer::default(),
+        }
+    }
+
+    fn write_frames(
+        callbacks: &SinkCallbacks,
+        format: AudioFormat,
+        frames: &[u8],
+    ) -> SinkResult<()> {
+        let frame_count = frames.len() / frame_bytes(format);
+        if (callbacks.write)(
+            frames.as_ptr() as *const c_void,
+            frame_count,
+            callbacks.user_data as *mut c_void,
+        ) {
+            Ok(())
+        } else {
+            Err(SinkError::OnWrite("sink write callback failed".to_string()))
+        }
+    }
+}
+
+/// Returns the size in bytes of one interleaved frame in `format`.
+pub(crate) fn frame_bytes(format: AudioFormat) -> usize {
+    format.size() * NUM_CHANNELS as usize
+}
+
+/// Converts a decoded packet to `format` and passes the interleaved bytes to `write`.
+pub(crate) fn write_packet(
+    format: AudioFormat,
+    packet: &AudioPacket,
+    converter: &mut PcmConverter,
+    write: impl FnOnce(&[u8]) -> SinkResult<()>,
+) -> SinkResult<()> {
+    let samples = packet
+        .samples()
+        .map_err(|err| SinkError::OnWrite(format!("unsupported audio packet: {err:?}")))?;
+    converter.convert(format, samples, write)
+}
+
+impl Sink for CallbackSink {
+    fn start(&mut self) -> SinkResult<()> {
+        let _span = trace::span("playback", "sink.start");
+        self.timer.reset();
+        match self.callbacks.start {
+            Some(start) if !start(self.callbacks.user_data as *mut c_void) => Err(
+                SinkError::StateChange("sink start callback failed".to_string()),
+            ),
+            _ => Ok(()),
+        }
+    }
+
+    fn stop(&mut self) -> SinkResult<()> {
+        let _span = trace::span("playback", "sink.stop");
+        self.timer.reset();
+        match self.callbacks.stop {
+            Some(stop) if !stop(self.callbacks.user_data as *mut c_void) => Err(
+                SinkError::StateChange("sink stop callback failed".to_string()),
+            ),
+            _ => Ok(()),
+        }
+    }
+
+    fn write(&mut self, packet: AudioPacket, _converter: &mut Converter) -> SinkResult<()> {
+        let (callbacks, format, converter) = (&self.callbacks, self.format, &mut self.converter);
+        self.timer.time_write(|| {
+            write_packet(format, &packet, converter, |frames| {
+                Self::write_frames(callbacks, format, frames)
+            })
+        })
+    }
+}
+
+/// Wraps one of librespot's audio backends so its writes are timed like cspot's own
+/// sinks.
+pub(crate) struct TimedSink {
+    inner: Box<dyn Sink>,
+    timer: PacketTimer,
+}
+
+impl TimedSink {
+    pub(crate) fn new(inner: Box<dyn Sink>) -> Self {
+        Self {
+            inner,
+            timer: PacketTimer::default(),
+        }
+    }
+}
+
+impl Sink for TimedSink {
+    fn start(&mut self) -> SinkResult<()> {
+        let _span = trace::span("playback", "sink.start");
+        self.timer.reset();
+        self.inner.start()
+    }
+
+    fn stop(&mut self) -> SinkResult<()> {
+        let _span = trace::span("playback", "sink.stop");
+        self.timer.reset();
+        self.inner.stop()
+    }
+
+    fn write(&mut self, packet: AudioPacket, converter: &mut Converter) -> SinkResult<()> {
+        let inner = &mut self.inner;
+        self.timer.time_write(|| inner.write(packet, converter))
+    }
+}
@@ -0,0 +1,442 @@
+//! Timeline tracing that writes startup and playback stages as a Chrome trace
+//! (JSON) file, which chrome://tracing and Perfetto open.
+//!
+//! While tracing is off, every instrumentation point costs one relaxed atomic load.
+//! While it is on, events go to a buffer owned by the recording thread, so threads
+//! only contend with `cspot_trace_stop` collecting them.
+
+use std::borrow::Cow;
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::os::raw::c_char;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Instant;
+
+use log::Record;
+use once_cell::sync::Lazy;
+
+use crate::error::{clear_error, cspot_error_t, write_error};
+use crate::ffi::read_cstr;
+
+/// Events a single thread may buffer during one trace; later ones are dropped.
+const MAX_EVENTS_PER_THREAD: usize = 1 << 18;
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static DROPPED_EVENTS: AtomicU64 = AtomicU64::new(0);
+static NEXT_TID: AtomicU64 = AtomicU64::new(1);
+/// Origin of event timestamps, fixed for the life of the process.
+static EPOCH: Lazy<Instant> = Lazy::new(Instant::now);
+/// Buffers of every thread that has recorded an event since the last stop.
+static THREADS: Mutex<Vec<Arc<ThreadBuffer>>> = Mutex::new(Vec::new());
+static SESSION: Mutex<Option<TraceSession>> = Mutex::new(None);
+
+thread_local! {
+    static THREAD_BUFFER: Arc<ThreadBuffer> = ThreadBuffer::register();
+}
+
+struct TraceSession {
+    out: BufWriter<File>,
+    start_ns: u64,
+}
+
+enum Phase {
+    /// Work that started and finished on the recording thread.
+    Complete {
+        dur_ns: u64,
+    },
+    /// Work that may have moved between threads, such as a future across awaits.
+    Async {
+        dur_ns: u64,
+    },
+    Instant,
+}
+
+struct Event {
+    category: &'static str,
+    name: Cow<'static, str>,
+    detail: Option<String>,
+    phase: Phase,
+    ts_ns: u64,
+}
+
+struct ThreadBuffer {
+    tid: u64,
+    name: String,
+    events: Mutex<Vec<Event>>,
+}
+
+impl ThreadBuffer {
+    fn register() -> Arc<Self> {
+        let tid = NEXT_TID.fetch_add(1, Ordering::Relaxed);
+        let name = match std::thread::current().name() {
+            Some(name) => format!("{name} ({tid})"),
+            None => format!("thread {tid}"),
+        };
+        let buffer = Arc::new(Self {
+            tid,
+            name,
+            events: Mutex::new(Vec::new()),
+        });
+        THREADS
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .push(Arc::clone(&buffer));
+        buffer
+    }
+
+    fn push(&self, event: Event) {
+        let mut events = self
+            .events
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        if events.len() < MAX_EVENTS_PER_THREAD {
+            events.push(event);
+        } else {
+            DROPPED_EVENTS.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+}
+
+/// Returns whether a trace is being recorded.
+pub(crate) fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+fn now_ns() -> u64 {
+    instant_ns(Instant::now())
+}
+
+fn instant_ns(instant: Instant) -> u64 {
+    instant.saturating_duration_since(*EPOCH).as_nanos() as u64
+}
+
+fn record(event: Event) {
+    // Threads that are shutting down have no buffer left; their events are lost.
+    let _ = THREAD_BUFFER.try_with(|buffer| buffer.push(event));
+}
+
+/// A traced stage that ends when dropped.
+#[must_use = "a span ends when it is dropped"]
+pub(crate) struct Span {
+    category: &'static str,
+    name: &'static str,
+    start_ns: Option<u64>,
+    is_async: bool,
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        let Some(start_ns) = self.start_ns else {
+            return;
+        };
+        if !enabled() {
+            return;
+        }
+        let dur_ns = now_ns().saturating_sub(start_ns);
+        record(Event {
+            category: self.category,
+            name: Cow::Borrowed(self.name),
+            detail: None,
+            phase: if self.is_async {
+                Phase::Async { dur_ns }
+            } else {
+                Phase::Complete { dur_ns }
+            },
+            ts_ns: start_ns,
+        });
+    }
+}
+
+fn start_span(category: &'static str, name: &'static str, is_async: bool) -> Span {
+    Span {
+        category,
+        name,
+        start_ns: enabled().then(now_ns),
+        is_async,
+    }
+}
+
+/// Starts a span for work that stays on the current thread.
+pub(crate) fn span(category: &'static str, name: &'static str) -> Span {
+    start_span(category, name, false)
+}
+
+/// Starts a span for work that awaits, and so may finish on another thread. It is
+/// shown on its own track rather than nested in the thread it started on.
+pub(crate) fn async_span(category: &'static str, name: &'static str) -> Span {
+    start_span(category, name, true)
+}
+
+/// Records work on the current thread that ran from `start` to `end`.
+pub(crate) fn complete(category: &'static str, name: &'static str, start: Instant, end: Instant) {
+    if !enabled() {
+        return;
+    }
+    record(Event {
+        category,
+        name: Cow::Borrowed(name),
+        detail: None,
+        phase: Phase::Complete {
+            dur_ns: end.saturating_duration_since(start).as_nanos() as u64,
+        },
+        ts_ns: instant_ns(start),
+    });
+}
+
+/// Records a stage that began at `start` and has just ended, such as one observed
+/// through events rather than by wrapping code.
+pub(crate) fn async_since(
+    category: &'static str,
+    name: &'static str,
+    start: Instant,
+    detail: impl FnOnce() -> String,
+) {
+    if !enabled() {
+        return;
+    }
+    let ts_ns = instant_ns(start);
+    record(Event {
+        category,
+        name: Cow::Borrowed(name),
+        detail: Some(detail()),
+        phase: Phase::Async {
+            dur_ns: now_ns().saturating_sub(ts_ns),
+        },
+        ts_ns,
+    });
+}
+
+/// Marks a point in time on the current thread.
+pub(crate) fn instant(category: &'static str, name: &'static str) {
+    if !enabled() {
+        return;
+    }
+    record(Event {
+        category,
+        name: Cow::Borrowed(name),
+        detail: None,
+        phase: Phase::Instant,
+        ts_ns: now_ns(),
+    });
+}
+
+/// Marks a log record that passed the logger's filter, so stages inside librespot
+/// that are only visible through its logging still appear on the timeline.
+pub(crate) fn log_record(entry: &Record) {
+    if !enabled() {
+        return;
+    }
+    record(Event {
+        category: "log",
+        name: Cow::Owned(entry.args().to_string()),
+        detail: Some(format!("{} {}", entry.level(), entry.target())),
+        phase: Phase::Instant,
+        ts_ns: now_ns(),
+    });
+}
+
+fn write_json_str(out: &mut impl Write, value: &str) -> std::io::Result<()> {
+    out.write_all(b"\"")?;
+    let mut rest = value;
+    while let Some(index) = rest.find(|c: char| c == '"' || c == '\\' || c < ' ') {
+        out.write_all(rest[..index].as_bytes())?;
+        match rest.as_bytes()[index] {
+            b'"' => out.write_all(b"\\\"")?,
+            b'\\' => out.write_all(b"\\\\")?,
+            b'\n' => out.write_all(b"\\n")?,
+            byte => write!(out, "\\u{byte:04x}")?,
+        }
+        rest = &rest[index + 1..];
+    }
+    out.write_all(rest.as_bytes())?;
+    out.write_all(b"\"")
+}
+
+/// Writes a nanosecond count as the fractional microseconds the format expects.
+fn write_us(out: &mut impl Write, ns: u64) -> std::io::Result<()> {
+    write!(out, "{}.{:03}", ns / 1000, ns % 1000)
+}
+
+/// Writes the fields shared by every event, leaving the object open.
+fn write_event_head(
+    out: &mut impl Write,
+    phase: &str,
+    event: &Event,
+    pid: u32,
+    tid: u64,
+    ts_ns: u64,
+) -> std::io::Result<()> {
+    write!(
+        out,
+        ",\n{{\"ph\":\"{phase}\",\"cat\":\"{}\",\"name\":",
+        event.category
+    )?;
+    write_json_str(out, &event.name)?;
+    write!(out, ",\"pid\":{pid},\"tid\":{tid},\"ts\":")?;
+    write_us(out, ts_ns)
+}
+
+fn write_event_tail(out: &mut impl Write, event: &Event) -> std::io::Result<()> {
+    if let Some(detail) = &event.detail {
+        out.write_all(b",\"args\":{\"detail\":")?;
+        write_json_str(out, detail)?;
+        out.write_all(b"}")?;
+    }
+    out.write_all(b"}")
+}
+
+fn write_trace(
+    out: &mut impl Write,
+    start_ns: u64,
+    threads: &[(Arc<ThreadBuffer>, Vec<Event>)],
+) -> std::io::Result<()> {
+    let pid = std::process::id();
+    write!(
+        out,
+        "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n\
+         {{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":{pid},\"tid\":0,\
+         \"args\":{{\"name\":\"cspot\"}}}}"
+    )?;
+    let mut next_id = 1u64;
+    for (thread, events) in threads {
+        let tid = thread.tid;
+        write!(
+            out,
+            ",\n{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":{pid},\"tid\":{tid},\"args\":{{\"name\":"
+        )?;
+        write_json_str(out, &thread.name)?;
+        out.write_all(b"}}")?;
+
+        for event in events {
+            // Spans that began before the trace started are left out.
+            let Some(ts_ns) = event.ts_ns.checked_sub(start_ns) else {
+                continue;
+            };
+            match event.phase {
+                Phase::Complete { dur_ns } => {
+                    write_event_head(out, "X", event, pid, tid, ts_ns)?;
+                    out.write_all(b",\"dur\":")?;
+                    write_us(out, dur_ns)?;
+                    write_event_tail(out, event)?;
+                }
+                Phase::Async { dur_ns } => {
+                    let id = next_id;
+                    next_id += 1;
+                    write_event_head(out, "b", event, pid, tid, ts_ns)?;
+                    write!(out, ",\"id\":{id}")?;
+                    write_event_tail(out, event)?;
+                    write_event_head(out, "e", event, pid, tid, ts_ns + dur_ns)?;
+                    write!(out, ",\"id\":{id}}}")?;
+                }
+                Phase::Instant => {
+                    write_event_head(out, "i", event, pid, tid, ts_ns)?;
+                    out.write_all(b",\"s\":\"t\"")?;
+                    write_event_tail(out, event)?;
+                }
+            }
+        }
+    }
+    out.write_all(b"\n]}\n")?;
+    out.flush()
+}
+
+/// Takes the events buffered by every thread and forgets threads that have exited.
+fn take_events() -> Vec<(Arc<ThreadBuffer>, Vec<Event>)> {
+    let mut threads = THREADS
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    let taken = threads
+        .iter()
+        .map(|thread| {
+            let events = std::mem::take(
+                &mut *thread
+                    .events
+                    .lock()
+                    .unwrap_or_else(|poisoned| poisoned.into_inner()),
+            );
+            (Arc::clone(thread), events)
+        })
+        .filter(|(_, events)| !events.is_empty())
+        .collect();
+    // The thread-local holds the other reference while the thread is alive.
+    threads.retain(|thread| Arc::strong_count(thread) > 1);
+    taken
+}
+
+/// Starts recording a timeline of cspot's startup and playback stages.
+///
+/// Spans cover discovery, session creation, Connect (`Spirc`) setup, which includes
+/// the access point connection and login, prefetch metadata lookups and audio file
+/// opens, track loads, decoding and sink writes, on every thread they run on. When
+/// logging is initialized, records that pass the log filter are added as instant
+/// events, which shows librespot's internal stages such as audio key and CDN
+/// requests at the `debug` level.
+///
+/// `path` is created, or truncated, immediately; the timeline is written to it by
+/// `cspot_trace_stop` as Chrome trace JSON, which chrome://tracing and
+/// https://ui.perfetto.dev open. Returns false and writes an error if a trace is
+/// already being recorded or the file cannot be created.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_trace_start(
+    path: *const c_char,
+    out_error: *mut *mut cspot_error_t,
+) -> bool {
+    clear_error(out_error);
+    let Some(path) = read_cstr(path, "path", out_error) else {
+        return false;
+    };
+    let mut session = SESSION
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    if session.is_some() {
+        write_error(out_error, "a trace is already being recorded");
+        return false;
+    }
+    let file = match File::create(&path) {
+        Ok(file) => file,
+        Err(err) => {
+            write_error(out_error, format!("failed to create {path}: {err}"));
+            return false;
+        }
+    };
+    // Discard anything recorded after the previous trace stopped.
+    drop(take_events());
+    DROPPED_EVENTS.store(0, Ordering::Relaxed);
+    *session = Some(TraceSession {
+        out: BufWriter::new(file),
+        start_ns: now_ns(),
+    });
+    ENABLED.store(true, Ordering::Relaxed);
+    true
+}
+
+/// Stops recording and writes the timeline to the file given to `cspot_trace_start`.
+///
+/// Returns false and writes an error if no trace is being recorded or the file could
+/// not be written. Each thread keeps at most 262144 events per trace; a warning is
+/// logged if any were dropped.
+#[unsafe(no_mangle)]
+pub extern "C" fn cspot_trace_stop(out_error: *mut *mut cspot_error_t) -> bool {
+    clear_error(out_error);
+    let mut session = SESSION
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    let Some(mut session) = session.take() else {
+        write_error(out_error, "no trace is being recorded");
+        return false;
+    };
+    ENABLED.store(false, Ordering::Relaxed);
+    let threads = take_events();
+    let dropped = DROPPED_EVENTS.load(Ordering::Relaxed);
+    if dropped > 0 {
+        log::warn!("trace buffers were full; dropped {dropped} events");
+    }
+    match write_trace(&mut session.out, session.start_ns, &threads) {
+        Ok(()) => true,
+        Err(err) => {
+            write_error(out_error, format!("failed to write trace: {err}"));
+            false
+        }
+    }
+}
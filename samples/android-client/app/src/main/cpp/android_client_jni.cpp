@@ -67,13 +67,11 @@ std::string consume_error(cspot_error_t *error) {
     return text;
 }
 
-std::string copy_and_free_cspot_string(char *value) {
+std::string copy_cspot_string(const char *value) {
     if (value == nullptr) {
         return {};
     }
-    std::string out(value);
-    cspot_string_free(value);
-    return out;
+    return std::string(value);
 }
 
 std::string json_escape(const std::string &value) {
@@ -198,7 +196,9 @@ bool initialize_android_runtime_context(
 
 class Engine {
   public:
-    Engine() = default;
+    Engine() { cspot_spirc_status_init(&status_); }
+
+    ~Engine() { cspot_spirc_status_release(&status_); }
 
     void start(const std::string &device_name) {
         std::string normalized = device_name;
@@ -248,18 +248,17 @@ class Engine {
             status_message = status_message_;
             device_name = device_name_;
 
-            if (spirc_ != nullptr) {
-                connected = cspot_spirc_is_connected(spirc_);
-                playback_state = static_cast<int>(cspot_spirc_playback_state(spirc_));
-                position_ms = cspot_spirc_current_position_ms(spirc_);
-                duration_ms = cspot_spirc_current_track_duration_ms(spirc_);
-                volume = cspot_spirc_current_volume(spirc_);
-
-                title = copy_and_free_cspot_string(cspot_spirc_current_track_title(spirc_));
-                artist = copy_and_free_cspot_string(cspot_spirc_current_track_artist(spirc_));
-                album = copy_and_free_cspot_string(cspot_spirc_current_track_album(spirc_));
-                artwork_url =
-                    copy_and_free_cspot_string(cspot_spirc_current_track_artwork_url(spirc_));
+            if (spirc_ != nullptr && cspot_spirc_get_status(spirc_, &status_)) {
+                connected = status_.connected;
+                playback_state = static_cast<int>(status_.playback_state);
+                position_ms = status_.position_ms;
+                duration_ms = status_.duration_ms;
+                volume = status_.volume;
+
+                title = copy_cspot_string(status_.title);
+                artist = copy_cspot_string(status_.artist);
+                album = copy_cspot_string(status_.album);
+                artwork_url = copy_cspot_string(status_.artwork_url);
             }
         }
 
@@ -463,6 +462,7 @@ class Engine {
         config.level = CSPOT_LOG_LEVEL_DEBUG;
         config.callback = android_cspot_log_callback;
         config.user_data = nullptr;
+        config.delivery = CSPOT_LOG_DELIVERY_ASYNC;
 
         cspot_error_t *error = nullptr;
         if (!cspot_log_init(&config, &error)) {
@@ -756,6 +756,9 @@ class Engine {
     cspot_connect_config_t *connect_config_ = nullptr;
     cspot_spirc_t *spirc_ = nullptr;
     cspot_spirc_task_t *spirc_task_ = nullptr;
+
+    // Reused across snapshots so steady-state refreshes do not allocate.
+    cspot_spirc_status_t status_;
 };
 
 Engine g_engine;
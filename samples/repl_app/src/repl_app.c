@@ -64,6 +64,46 @@ static const char *playback_state_name(cspot_playback_state_t state)
     }
 }
 
+static const char *event_kind_name(cspot_event_kind_t kind)
+{
+    switch (kind) {
+    case CSPOT_EVENT_PLAYBACK_STATE_CHANGED:
+        return "state";
+    case CSPOT_EVENT_TRACK_CHANGED:
+        return "track";
+    case CSPOT_EVENT_SEEKED:
+        return "seek";
+    case CSPOT_EVENT_VOLUME_CHANGED:
+        return "volume";
+    case CSPOT_EVENT_SHUFFLE_CHANGED:
+        return "shuffle";
+    case CSPOT_EVENT_REPEAT_CHANGED:
+        return "repeat";
+    case CSPOT_EVENT_SESSION_CONNECTED:
+        return "connected";
+    case CSPOT_EVENT_SESSION_DISCONNECTED:
+        return "disconnected";
+    default:
+        return "unknown";
+    }
+}
+
+static void print_event(const cspot_event_t *event, void *user_data)
+{
+    (void)user_data;
+    if (!event) {
+        return;
+    }
+    printf(
+        "\n[event] %s: state=%s pos=%u/%u ms volume=%u\n",
+        event_kind_name(event->kind),
+        playback_state_name(event->playback_state),
+        event->position_ms,
+        event->duration_ms,
+        event->volume);
+    fflush(stdout);
+}
+
 static bool parse_on_off(const char *text, bool *value)
 {
     if (!text || !value) {
@@ -153,50 +193,40 @@ cleanup:
 
 static void print_status(cspot_spirc_t *spirc)
 {
-    bool connected = cspot_spirc_is_connected(spirc);
-    cspot_playback_state_t state = cspot_spirc_playback_state(spirc);
-    uint32_t position_ms = cspot_spirc_current_position_ms(spirc);
-    uint32_t duration_ms = cspot_spirc_current_track_duration_ms(spirc);
-    uint16_t volume = cspot_spirc_current_volume(spirc);
-
-    char *track_id = cspot_spirc_current_track_id(spirc);
-    char *track_uri = cspot_spirc_current_track_uri(spirc);
-    char *artist = cspot_spirc_current_track_artist(spirc);
-    char *album = cspot_spirc_current_track_album(spirc);
-    char *title = cspot_spirc_current_track_title(spirc);
-    char *artwork_url = cspot_spirc_current_track_artwork_url(spirc);
+    cspot_spirc_status_t status;
+    cspot_spirc_status_init(&status);
+
+    if (!cspot_spirc_get_status(spirc, &status)) {
+        puts("status unavailable");
+        return;
+    }
 
     printf(
         "connected=%s state=%s pos=%u/%u ms volume=%u shuffle=%s repeat=%s repeat_track=%s\n",
-        connected ? "yes" : "no",
-        playback_state_name(state),
-        position_ms,
-        duration_ms,
-        volume,
-        cspot_spirc_is_shuffle_enabled(spirc) ? "on" : "off",
-        cspot_spirc_is_repeat_context_enabled(spirc) ? "on" : "off",
-        cspot_spirc_is_repeat_track_enabled(spirc) ? "on" : "off");
+        status.connected ? "yes" : "no",
+        playback_state_name(status.playback_state),
+        status.position_ms,
+        status.duration_ms,
+        status.volume,
+        status.shuffle_enabled ? "on" : "off",
+        status.repeat_context_enabled ? "on" : "off",
+        status.repeat_track_enabled ? "on" : "off");
 
     printf(
         "track: id=%s title=%s artist=%s album=%s\n",
-        track_id ? track_id : "(none)",
-        title ? title : "(none)",
-        artist ? artist : "(none)",
-        album ? album : "(none)");
+        status.track_id ? status.track_id : "(none)",
+        status.title ? status.title : "(none)",
+        status.artist ? status.artist : "(none)",
+        status.album ? status.album : "(none)");
 
-    if (track_uri) {
-        printf("uri: %s\n", track_uri);
+    if (status.track_uri) {
+        printf("uri: %s\n", status.track_uri);
     }
-    if (artwork_url) {
-        printf("artwork: %s\n", artwork_url);
+    if (status.artwork_url) {
+        printf("artwork: %s\n", status.artwork_url);
     }
 
-    cspot_string_free(track_id);
-    cspot_string_free(track_uri);
-    cspot_string_free(artist);
-    cspot_string_free(album);
-    cspot_string_free(title);
-    cspot_string_free(artwork_url);
+    cspot_spirc_status_release(&status);
 }
 
 static void print_help(void)
@@ -204,6 +234,8 @@ static void print_help(void)
     puts("Commands:");
     puts("  help");
     puts("  status");
+    puts("  watch <on|off>");
+    puts("  events");
     puts("  activate");
     puts("  transfer");
     puts("  play");
@@ -470,6 +502,36 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (strcmp(cmd, "watch") == 0) {
+            bool enabled = false;
+            if (!parse_on_off(arg, &enabled)) {
+                puts("usage: watch <on|off>");
+                continue;
+            }
+            if (!cspot_spirc_set_event_callback(spirc, enabled ? print_event : NULL, NULL, &error)) {
+                report_error("watch failed", error);
+                error = NULL;
+            }
+            continue;
+        }
+
+        if (strcmp(cmd, "events") == 0) {
+            cspot_event_t events[64];
+            size_t total = 0;
+            size_t count = 0;
+            while ((count = cspot_spirc_drain_events(spirc, events, 64)) > 0) {
+                for (size_t i = 0; i < count; ++i) {
+                    print_event(&events[i], NULL);
+                }
+                total += count;
+            }
+            printf(
+                "%zu events drained, %llu dropped\n",
+                total,
+                (unsigned long long)cspot_spirc_dropped_event_count(spirc));
+            continue;
+        }
+
         if (strcmp(cmd, "activate") == 0) {
             if (!cspot_spirc_activate(spirc, &error)) {
                 report_error("activate failed", error);